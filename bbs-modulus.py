@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+#
+# Usage: bbs-modulus.py [--bits N] [--keep-factors]
+#
+# Generates the Blum integer bbs_M used by the doom backend in lib/crng.c:
+# M = p * q with p and q safe primes (p = 2p' + 1, p' prime), which makes
+# both of them congruent to 3 mod 4. Every prime is checked with 64 rounds
+# of Miller-Rabin, M is checked to have exactly N bits and to be 1 mod 4,
+# then M is printed as the struct bn initializer, 32-bit words, least
+# significant first.
+#
+# The factors are the trapdoor of the generator and are not printed unless
+# --keep-factors is given (they go to stderr then). The bbs_M committed in
+# lib/crng.c is the output of this script run without --keep-factors, so
+# nobody holds its factors; a build that wants its own modulus reruns the
+# script and pastes the result.
+
+from __future__ import print_function
+
+import sys, secrets
+from optparse import OptionParser
+
+SMALL_PRIMES = [p for p in range(3, 20000) if all(p % d for d in range(2, int(p ** 0.5) + 1))]
+
+def is_probable_prime(n, rounds=64):
+    if n < 2:
+        return False
+    for p in SMALL_PRIMES:
+        if n % p == 0:
+            return n == p
+    d, s = n - 1, 0
+    while d % 2 == 0:
+        d, s = d // 2, s + 1
+    for _ in range(rounds):
+        a = secrets.randbelow(n - 3) + 2
+        x = pow(a, d, n)
+        if x in (1, n - 1):
+            continue
+        for _ in range(s - 1):
+            x = x * x % n
+            if x == n - 1:
+                break
+        else:
+            return False
+    return True
+
+def safe_prime(bits):
+    """p = 2p' + 1 of exactly {bits} bits, p and p' prime"""
+    while True:
+        # p' odd with the top two bits set, so p * q has exactly 2 * bits bits
+        q = secrets.randbits(bits - 1) | (3 << (bits - 3)) | 1
+        p = 2 * q + 1
+        # sieve both before the expensive tests
+        if any(q % d == 0 or p % d == 0 for d in SMALL_PRIMES):
+            continue
+        if pow(2, p - 1, p) != 1 or not is_probable_prime(q) or not is_probable_prime(p):
+            continue
+        return p
+
+def main():
+    parser = OptionParser(usage="usage: %prog [--bits N] [--keep-factors]")
+    parser.add_option("--bits", type="int", default=1024, help="bits of M, a multiple of 64")
+    parser.add_option("--keep-factors", action="store_true", default=False,
+                      help="print p and q to stderr")
+    opts, args = parser.parse_args()
+    if args or opts.bits % 64:
+        parser.error("bits must be a multiple of 64")
+
+    while True:
+        p, q = safe_prime(opts.bits // 2), safe_prime(opts.bits // 2)
+        if p != q:
+            break
+    M = p * q
+    assert p % 4 == 3 and q % 4 == 3
+    assert is_probable_prime((p - 1) // 2) and is_probable_prime((q - 1) // 2)
+    assert M.bit_length() == opts.bits and M % 4 == 1
+
+    if opts.keep_factors:
+        print("p = 0x%x" % p, file=sys.stderr)
+        print("q = 0x%x" % q, file=sys.stderr)
+    words = [(M >> (32 * i)) & 0xffffffff for i in range(opts.bits // 32)]
+    print("static struct bn bbs_M = {{")
+    for i in range(0, len(words), 4):
+        print("    " + " ".join("0x%08x," % w for w in words[i:i + 4]))
+    print("}};")
+
+if __name__ == "__main__":
+    main()
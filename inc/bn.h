@@ -118,7 +118,7 @@ int  bignum_cmp(struct bn* a, struct bn* b);               /* Compare: returns L
 int  bignum_is_zero(struct bn* n);                         /* For comparison with zero */
 void bignum_inc(struct bn* n);                             /* Increment: add one to n */
 void bignum_dec(struct bn* n);                             /* Decrement: subtract one from n */
-void bignum_pow(struct bn* a, struct bn* b, struct bn* c); /* Calculate a^b -- e.g. 2^10 => 1024 */
+void bignum_pow(struct bn* a, struct bn* b, struct bn* c); /* Calculate a^b -- e.g. 2^10 => 1024, low limbs only */
 void bignum_isqrt(struct bn* a, struct bn* b);             /* Integer square root -- e.g. isqrt(5) => 2*/
 void bignum_assign(struct bn* dst, struct bn* src);        /* Copy src into dst -- dst := src */
 
@@ -135,6 +135,96 @@ void bignum_negate(bignum* x, bignum* n);
 void bignum_reverse(bignum* x, bignum* b, bignum* m);
 void bignum_from_str_dex(bignum* n, const char* src, int64_t len);
 void bignum_from_str(bignum* n, const char* src, int64_t len);
+int  bignum_bit_length(struct bn* n);                       /* Index of the highest set bit plus one */
+
+/* Montgomery arithmetic modulo an odd m, R = 2^(8 * WORD_SIZE * BN_ARRAY_SIZE), a < m.
+   A value x is kept as x * R mod m, so long chains of products pay for the
+   conversion only at their ends. */
+typedef struct bn_mont_ctx
+{
+    struct bn m;
+    struct bn rr; /* R^2 mod m */
+    DTYPE minv;   /* -m^-1 mod 2^(8 * WORD_SIZE) */
+} bn_mont_ctx;
+
+DTYPE bignum_mont_minv(struct bn* m);                                                /* -m^-1 mod 2^(8 * WORD_SIZE) */
+void bignum_mont_init(bn_mont_ctx* ctx, struct bn* m);
+void bignum_mont_mul(struct bn* a, struct bn* b, struct bn* c, const bn_mont_ctx* ctx); /* c = a * b / R mod m */
+void bignum_mont_sqr(struct bn* a, struct bn* c, const bn_mont_ctx* ctx);               /* c = a^2 / R mod m */
+void bignum_to_mont(struct bn* a, struct bn* c, const bn_mont_ctx* ctx);                /* c = a * R mod m, any a */
+void bignum_from_mont(struct bn* a, struct bn* c, const bn_mont_ctx* ctx);              /* c = a / R mod m */
+void bignum_mont_pow(struct bn* a, struct bn* e, struct bn* c, const bn_mont_ctx* ctx); /* c = a^e mod m, plain in and out */
+void bignum_pow_mod(struct bn* a, struct bn* e, struct bn* m, struct bn* c);            /* c = a^e mod m, any m > 0 */
+
+
+/*
+  Fixed-width families. BN_DECLARE_WIDTH(bits) declares bn<bits>, just wide
+  enough for a <bits>-bit value, the double width bn<bits>w that holds its
+  products, and the same operations as above with every loop bound fixed at
+  compile time. Modular operations expect operands already reduced, a
+  modulus may use every bit of the type. Products are reduced through a
+  bn<bits>_barrett context set up once per modulus, bn<bits>_mod() is the
+  plain long division. bn<bits>_mont holds the same for Montgomery form
+  modulo an odd m, the mont_ operations take and return values times R.
+  bn<bits>_reverse() is the binary inversion for an odd m, extended Euclid
+  for an even one.
+*/
+#define BN_WORDS(bits) (((bits) + 8 * WORD_SIZE - 1) / (8 * WORD_SIZE))
+
+/* Products of at least this many limbs use Karatsuba, operands are at most BN_ARRAY_SIZE + 1 limbs */
+extern int bn_karatsuba_words;
+
+#define BN_DECLARE_WIDTH(bits)                                                                   \
+    typedef struct { DTYPE array[BN_WORDS(bits)]; } bn##bits;                                    \
+    typedef struct { DTYPE array[2 * BN_WORDS(bits)]; } bn##bits##w;                             \
+    typedef struct {                                                                             \
+        bn##bits m;                                                                              \
+        DTYPE mu[BN_WORDS(bits) + 1]; /* B^(2 words) / m, B = 2^(8 * WORD_SIZE) */               \
+        int barrett;                  /* 0 if m leaves the top limb empty, reduce by division */ \
+    } bn##bits##_barrett;                                                                        \
+    typedef struct {                                                                             \
+        bn##bits m;                                                                              \
+        bn##bits rr;                  /* R^2 mod m, R = 2^(8 * WORD_SIZE * words) */             \
+        DTYPE minv;                   /* -m^-1 mod 2^(8 * WORD_SIZE) */                          \
+    } bn##bits##_mont;                                                                           \
+    void  bn##bits##_init(bn##bits* n);                                                          \
+    void  bn##bits##_from_int(bn##bits* n, DTYPE_TMP i);                                         \
+    void  bn##bits##_from_bignum(bn##bits* n, const struct bn* m);  /* n = m mod 2^bits */       \
+    void  bn##bits##_to_bignum(struct bn* n, const bn##bits* m);                                 \
+    void  bn##bits##_copy(bn##bits* n, const bn##bits* m);                                       \
+    int   bn##bits##_cmp(const bn##bits* a, const bn##bits* b);                                  \
+    int   bn##bits##_is_zero(const bn##bits* n);                                                 \
+    int   bn##bits##_bit(const bn##bits* n, int i);                                              \
+    int   bn##bits##_bit_length(const bn##bits* n);                                              \
+    DTYPE bn##bits##_add(const bn##bits* a, const bn##bits* b, bn##bits* c); /* carry out */     \
+    DTYPE bn##bits##_sub(const bn##bits* a, const bn##bits* b, bn##bits* c); /* borrow out */    \
+    void  bn##bits##_mul(const bn##bits* a, const bn##bits* b, bn##bits##w* c);                  \
+    void  bn##bits##_sqr(const bn##bits* a, bn##bits##w* c);                                     \
+    void  bn##bits##_divmod(const bn##bits* a, const bn##bits* b, bn##bits* c, bn##bits* d);     \
+    void  bn##bits##_mod(const bn##bits##w* a, const bn##bits* m, bn##bits* c);                  \
+    void  bn##bits##_widen(const bn##bits* a, bn##bits##w* c);                                   \
+    void  bn##bits##_add_mod(const bn##bits* a, const bn##bits* b, bn##bits* c, const bn##bits* m); \
+    void  bn##bits##_sub_mod(const bn##bits* a, const bn##bits* b, bn##bits* c, const bn##bits* m); \
+    void  bn##bits##_barrett_init(bn##bits##_barrett* ctx, const bn##bits* m);                   \
+    void  bn##bits##_barrett_reduce(const bn##bits##w* a, const bn##bits##_barrett* ctx, bn##bits* c); \
+    void  bn##bits##_mul_mod(const bn##bits* a, const bn##bits* b, bn##bits* c, const bn##bits##_barrett* m); \
+    void  bn##bits##_sqr_mod(const bn##bits* a, bn##bits* c, const bn##bits##_barrett* m);       \
+    void  bn##bits##_mont_init(bn##bits##_mont* ctx, const bn##bits* m); /* m odd */             \
+    void  bn##bits##_mont_mul(const bn##bits* a, const bn##bits* b, bn##bits* c, const bn##bits##_mont* ctx); \
+    void  bn##bits##_mont_sqr(const bn##bits* a, bn##bits* c, const bn##bits##_mont* ctx);       \
+    void  bn##bits##_to_mont(const bn##bits* a, bn##bits* c, const bn##bits##_mont* ctx);        \
+    void  bn##bits##_from_mont(const bn##bits* a, bn##bits* c, const bn##bits##_mont* ctx);      \
+    void  bn##bits##_mont_pow(const bn##bits* a, const bn##bits* e, bn##bits* c, const bn##bits##_mont* ctx); \
+    void  bn##bits##_mont_reverse(const bn##bits* a, bn##bits* c, const bn##bits##_mont* ctx); /* Fermat, c = a^(m - 2), m prime */ \
+    void  bn##bits##_negate(bn##bits* x, const bn##bits* m);                                     \
+    void  bn##bits##_reverse(bn##bits* x, const bn##bits* b, const bn##bits* m); /* x * b = 1 (mod m) */
+
+BN_DECLARE_WIDTH(192)
+BN_DECLARE_WIDTH(224)
+BN_DECLARE_WIDTH(256)
+BN_DECLARE_WIDTH(384)
+BN_DECLARE_WIDTH(521)
+BN_DECLARE_WIDTH(1024)
 
 
 #endif // CRNG_BN_H
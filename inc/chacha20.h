@@ -0,0 +1,41 @@
+#ifndef JOS_INC_CHACHA20_H
+#define JOS_INC_CHACHA20_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/* ChaCha20 block function, original variant with a 64-bit block counter
+ * (words 12-13) and a 64-bit nonce (words 14-15).
+ *
+ * Blocks are produced by the best kernel the CPU and the OS allow:
+ * 8 blocks per pass with AVX2, 4 with SSE2, one at a time otherwise. */
+
+#define CHACHA20_KEY_WORDS   8
+#define CHACHA20_BLOCK_WORDS 16
+#define CHACHA20_BLOCK_BYTES (CHACHA20_BLOCK_WORDS * sizeof(uint32_t))
+
+struct chacha20_state {
+    uint32_t input[CHACHA20_BLOCK_WORDS];
+};
+
+enum chacha20_impl {
+    CHACHA20_SCALAR,
+    CHACHA20_SSE2,
+    CHACHA20_AVX2,
+    CHACHA20_NIMPL
+};
+
+void chacha20_init(struct chacha20_state *s, const uint32_t key[CHACHA20_KEY_WORDS], uint64_t nonce);
+/* Replaces the key, the counter keeps running */
+void chacha20_rekey(struct chacha20_state *s, const uint32_t key[CHACHA20_KEY_WORDS]);
+/* Writes {nblocks} keystream blocks to {out} and advances the counter */
+void chacha20_blocks(struct chacha20_state *s, uint32_t *out, size_t nblocks);
+
+/* Kernel selection. The best supported one is picked on first use. */
+bool chacha20_impl_supported(enum chacha20_impl impl);
+bool chacha20_set_impl(enum chacha20_impl impl);
+enum chacha20_impl chacha20_get_impl(void);
+const char *chacha20_impl_name(enum chacha20_impl impl);
+
+#endif /* !JOS_INC_CHACHA20_H */
@@ -6,6 +6,117 @@
 #ifndef OSCOURSE_CRNG_H
 #define OSCOURSE_CRNG_H
 #include <stdint.h>
+#include <stdbool.h>
+#include <inc/rand_isaac.h>
+#include <inc/chacha20.h>
+
+#include <stddef.h>
+
+/* Bytes of ISAAC output after which the stream mixes fresh seed words
+ * into its state (checked before every refill, including inside a fill). */
+#define ISAAC_STREAM_RESEED_BYTES (1UL << 20)
+
+/* ISAAC generator with an output buffer: one isaac_refill() produces
+ * ISAAC_BYTES of output, which are handed out until they run out.
+ * 32-bit, 64-bit and byte-stream accessors share the same buffer. */
+struct isaac_stream {
+    struct isaac_state state;
+    isaac_word buf[ISAAC_WORDS];
+    size_t pos; /* bytes of buf already consumed */
+    uint64_t (*seed_func)(void);
+    /* Optional bulk seed source, returns the number of words it produced;
+     * the rest of the seed comes from seed_func */
+    size_t (*harvest_func)(uint64_t *words, size_t n);
+    size_t reseed_interval; /* 0 disables reseeding */
+    size_t since_reseed;    /* bytes generated since last (re)seed */
+};
+
+void isaac_stream_init(struct isaac_stream *s, uint64_t (*seed_func)(void),
+                       size_t (*harvest_func)(uint64_t *words, size_t n));
+void isaac_stream_reseed(struct isaac_stream *s);
+uint64_t isaac_stream_next64(struct isaac_stream *s);
+uint32_t isaac_stream_next32(struct isaac_stream *s);
+void isaac_stream_fill(struct isaac_stream *s, void *buf, size_t len);
+
+/* Bytes of ChaCha20 output after which the stream mixes fresh seed words
+ * into its key (checked before every refill, including inside a fill). */
+#define CHACHA_STREAM_RESEED_BYTES (1UL << 20)
+/* Blocks per buffer refill, one AVX2 pass */
+#define CHACHA_STREAM_BLOCKS 8
+#define CHACHA_STREAM_WORDS  (CHACHA_STREAM_BLOCKS * CHACHA20_BLOCK_WORDS)
+#define CHACHA_STREAM_BYTES  (CHACHA_STREAM_WORDS * sizeof(uint32_t))
+
+/* ChaCha20 DRBG with fast key erasure: every buffer refill replaces the
+ * key with the first CHACHA20_KEY_WORDS words of its own output, so a
+ * later state compromise does not reveal earlier output. Bulk fills write
+ * whole blocks straight to the caller and then refill (and rekey). */
+struct chacha_stream {
+    struct chacha20_state state;
+    uint32_t buf[CHACHA_STREAM_WORDS];
+    size_t pos; /* bytes of buf already consumed */
+    uint64_t (*seed_func)(void);
+    size_t (*harvest_func)(uint64_t *words, size_t n);
+    size_t reseed_interval; /* 0 disables reseeding */
+    size_t since_reseed;    /* bytes generated since last (re)seed */
+};
+
+void chacha_stream_init(struct chacha_stream *s, uint64_t (*seed_func)(void),
+                        size_t (*harvest_func)(uint64_t *words, size_t n));
+void chacha_stream_reseed(struct chacha_stream *s);
+uint64_t chacha_stream_next64(struct chacha_stream *s);
+uint32_t chacha_stream_next32(struct chacha_stream *s);
+void chacha_stream_fill(struct chacha_stream *s, void *buf, size_t len);
+
+/* Bulk fills: write {len} random bytes to {buf}, any length and alignment.
+ * crng_fill() uses the selected backend. */
+void crng_fill(void *buf, size_t len);
+void crng_fill_rdrand(void *buf, size_t len);
+void crng_fill_doom(void *buf, size_t len);
+void crng_fill_chacha(void *buf, size_t len);
+
+/* Generators selectable at runtime: "rdrand" (RDRAND seeded ISAAC),
+ * "doom" (BBS) and "chacha" (RDRAND seeded ChaCha20, the default). */
+struct crng_backend {
+    const char *name;
+    uint64_t (*urand64)(void);
+    uint32_t (*urand32)(void);
+    void (*fill)(void *buf, size_t len);
+};
+
+#define CRNG_NBACKENDS 3
+extern const struct crng_backend crng_backends[CRNG_NBACKENDS];
+
+const struct crng_backend *crng_backend(void);
+/* NULL if there is no backend called {name} */
+const struct crng_backend *crng_backend_find(const char *name);
+/* Returns false if there is no backend called {name} */
+bool crng_backend_select(const char *name);
+
+/* Bounded retry counts recommended by Intel's DRNG guide */
+#define RDRAND_RETRIES 10
+#define RDSEED_RETRIES 100
+
+/* Hardware entropy counters, for diagnostics */
+struct crng_hw_stats {
+    uint64_t rdrand_retries;  /* RDRAND attempts that returned CF=0 */
+    uint64_t rdrand_failures; /* calls that ran out of RDRAND retries */
+    uint64_t rdseed_retries;
+    uint64_t rdseed_failures;
+    uint64_t rdseed_words;    /* words harvested with RDSEED */
+    uint64_t doom_fallbacks;  /* secure_rand64_rdrand() served by the doom path */
+};
+
+extern struct crng_hw_stats crng_hw_stats;
+
+/* Probe RDRAND/RDSEED support. Called once at boot, the result is cached. */
+void crng_hw_init(void);
+bool crng_has_rdrand(void);
+bool crng_has_rdseed(void);
+
+/* Fill {words} with up to {n} RDSEED values, returns how many it produced */
+size_t crng_rdseed_harvest(uint64_t *words, size_t n);
+/* Mix a full state worth of fresh RDSEED entropy into the ISAAC stream */
+void crng_reseed_rdseed(void);
 
 uint64_t secure_rand64_rdrand(void);
 uint32_t secure_rand32_rdrand(void);
@@ -13,6 +124,15 @@ uint32_t secure_rand32_rdrand(void);
 uint64_t secure_urand64_rdrand(void);
 uint32_t secure_urand32_rdrand(void);
 
+/* Reference path: one full isaac_refill() per value. Only for speed comparison. */
+uint64_t secure_urand64_rdrand_refill(void);
+
+uint64_t secure_urand64_chacha(void);
+uint32_t secure_urand32_chacha(void);
+
+
+/* Bits of scheduler entropy behind one secure_rand64_doom() value */
+#define DOOM_SEED_BITS 64
 
 uint64_t secure_rand64_doom(void);
 uint32_t secure_rand32_doom(void);
@@ -20,4 +140,7 @@ uint32_t secure_rand32_doom(void);
 uint64_t secure_urand64_doom(void);
 uint32_t secure_urand32_doom(void);
 
+/* Reference path: the old single-bit BBS over a 64-bit modulus. Only for speed comparison. */
+uint64_t secure_urand64_doom_bbs64(void);
+
 #endif // OSCOURSE_CRNG_H
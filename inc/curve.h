@@ -36,6 +36,7 @@ struct curve_s
     const char* b;
     const char* Gx;
     const char* Gy;
+    int bits; // width of p, picks the bignum family the curve runs on
 };
 
 struct bignum_curve_s
@@ -49,4 +50,79 @@ struct bignum_curve_s
     bignum Gy;
 };
 
+/* Width-specialized points and arithmetic over the bn<bits> families,
+   same semantics as the bignum versions above. Coordinates and a live in
+   the representation of a field<bits>: plain residues with the Solinas
+   reduction when p is the NIST prime of the width, Montgomery form for
+   any other odd p. A whole scalar multiplication converts only its input
+   and result, the points in between are Jacobian and the jacobian_
+   functions take a NULL a for a = -3. field<bits>_batch_reverse() inverts
+   n nonzero values for one inversion and 3 (n - 1) products, c must not
+   overlap a. comb<bits> holds the precomputed multiples of a fixed point
+   for comb<bits>_mul(), nbits bounds the scalars it is built for.
+   elliptic_mul_add_<bits>() is u1 G + u2 Q with G given by its comb. */
+/* Widest fixed-base comb, 2^CURVE_COMB_MAX_TEETH - 1 precomputed points */
+#define CURVE_COMB_MAX_TEETH 6
+#define CURVE_COMB_SIZE      ((1 << CURVE_COMB_MAX_TEETH) - 1)
+
+/* NAF width of the variable point in elliptic_mul_add_<bits>(), the odd
+   multiples Q .. (2^(w - 1) - 1) Q it precomputes */
+#define CURVE_WNAF_WIDTH 5
+#define CURVE_WNAF_SIZE  (1 << (CURVE_WNAF_WIDTH - 2))
+
+#define CURVE_DECLARE_WIDTH(bits)                                                                     \
+    typedef struct {                                                                                  \
+        bn##bits x;                                                                                   \
+        bn##bits y;                                                                                   \
+        int zero_flag;                                                                                \
+    } point##bits;                                                                                    \
+    typedef struct {                                                                                  \
+        bn##bits##_mont mont; /* the modulus, and the Montgomery constants of the generic path */     \
+        int solinas;          /* p is the NIST prime of this width */                                 \
+        bn##bits one;         /* 1 in the representation of the field */                              \
+    } field##bits;                                                                                    \
+    typedef struct {                                                                                  \
+        bn##bits X;                                                                                   \
+        bn##bits Y;                                                                                   \
+        bn##bits Z;           /* 0 for the point at infinity */                                       \
+    } jacobian##bits;                                                                                 \
+    void field##bits##_init(field##bits* f, const bn##bits* p);                                       \
+    void field##bits##_encode(const bn##bits* a, bn##bits* c, const field##bits* f);                  \
+    void field##bits##_decode(const bn##bits* a, bn##bits* c, const field##bits* f);                  \
+    void field##bits##_mul(const bn##bits* a, const bn##bits* b, bn##bits* c, const field##bits* f);  \
+    void field##bits##_sqr(const bn##bits* a, bn##bits* c, const field##bits* f);                     \
+    void field##bits##_reverse(const bn##bits* a, bn##bits* c, const field##bits* f);                 \
+    void field##bits##_batch_reverse(const bn##bits* a, bn##bits* c, int n, const field##bits* f);    \
+    typedef struct {                                                                                  \
+        int teeth;            /* (1 << teeth) - 1 entries of table are in use */                      \
+        int spacing;          /* bits between the teeth */                                            \
+        point##bits table[CURVE_COMB_SIZE];                                                           \
+    } comb##bits;                                                                                     \
+    void point##bits##_from_point(point##bits* dst, const point* src);                                \
+    void point##bits##_to_point(point* dst, const point##bits* src);                                  \
+    void point##bits##_encode(point##bits* dst, const point##bits* src, const field##bits* f);        \
+    void point##bits##_decode(point##bits* dst, const point##bits* src, const field##bits* f);        \
+    void point##bits##_to_jacobian(jacobian##bits* dst, const point##bits* src, const field##bits* f); \
+    void jacobian##bits##_to_point(point##bits* dst, const jacobian##bits* src, const field##bits* f); \
+    void jacobian##bits##_double(const jacobian##bits* p1, jacobian##bits* p3, const bn##bits* a,     \
+                                 const field##bits* p);                                               \
+    void jacobian##bits##_add_affine(const jacobian##bits* p1, const point##bits* p2,                 \
+                                     jacobian##bits* p3, const bn##bits* a, const field##bits* p);    \
+    void elliptic_add_##bits(const point##bits* p1, const point##bits* p2, point##bits* p3,           \
+                             const bn##bits* a, const field##bits* p);                                \
+    void elliptic_mul_##bits(const point##bits* x, const bn##bits* k, const bn##bits* a,              \
+                             const field##bits* p, point##bits* result);                              \
+    void comb##bits##_init(comb##bits* c, const point##bits* P, int teeth, int nbits, const bn##bits* a, \
+                           const field##bits* p);                                                     \
+    void comb##bits##_mul(const comb##bits* c, const bn##bits* k, const bn##bits* a,                  \
+                          const field##bits* p, point##bits* result);                                 \
+    void elliptic_mul_add_##bits(const comb##bits* c, const bn##bits* u1, const point##bits* Q,       \
+                                 const bn##bits* u2, const bn##bits* a, const field##bits* p,         \
+                                 point##bits* result);
+
+CURVE_DECLARE_WIDTH(192)
+CURVE_DECLARE_WIDTH(224)
+CURVE_DECLARE_WIDTH(256)
+CURVE_DECLARE_WIDTH(384)
+
 #endif // CRNG_CURVE_H
@@ -10,9 +10,47 @@
 #include <inc/curve.h>
 #include <inc/crng.h>
 
-void ecdsa_public_key(bignum *da, curve *ellip, point *ha);
+/* A curve parsed once: the field and group order contexts, G and
+   a = -3 mod p already in the field representation, the comb table of G.
+   Every operation takes the context read-only, ecdsa_curve_init() is the
+   only place the curve strings are read. */
+#define ECDSA_DECLARE_WIDTH(bits)                                                                     \
+    struct ecdsa_curve_##bits {                                                                       \
+        field##bits p;        /* G and a are in the representation of the field */                    \
+        bn##bits##_barrett n; /* the group order */                                                   \
+        bn##bits a;                                                                                   \
+        point##bits G;                                                                                \
+        comb##bits G_comb;    /* multiples of G for comb##bits##_mul() */                             \
+    };
+
+ECDSA_DECLARE_WIDTH(192)
+ECDSA_DECLARE_WIDTH(224)
+ECDSA_DECLARE_WIDTH(256)
+ECDSA_DECLARE_WIDTH(384)
+
+typedef struct ecdsa_curve_s
+{
+    int bits; // picks the member of the union below
+    union {
+        struct ecdsa_curve_192 c192;
+        struct ecdsa_curve_224 c224;
+        struct ecdsa_curve_256 c256;
+        struct ecdsa_curve_384 c384;
+    };
+} ecdsa_curve;
+
+/* Teeth of the fixed-base comb for G that ecdsa_curve_init() builds,
+   1 .. CURVE_COMB_MAX_TEETH: each one more doubles the table and cuts the
+   doublings of a key generation or signature by about a tooth's share */
+extern int ecdsa_comb_teeth;
+
+void ecdsa_curve_init(ecdsa_curve *ec, curve *ellip);
+void ecdsa_public_key(bignum *da, const ecdsa_curve *ec, point *ha);
+/* z is the hash as an integer below 2^bits, bits the width of the curve:
+   a longer hash must already be cut to its leftmost bits by the caller
+   (FIPS 186-4, 6.4). Sign and verify keep only the low bits of z. */
 void ecdsa_sign(
-        curve *ellip, // curve, IN
+        const ecdsa_curve *ec, // curve, IN
         bignum *z, // hash, IN
         bignum *da, // private key, IN
         bignum *r, // r, OUT
@@ -22,7 +60,7 @@ int ecdsa_verify(
         bignum *z, // z, IN
         bignum *r, // r, IN
         bignum *s, // s, IN
-        curve *ellip, // curve, IN
+        const ecdsa_curve *ec, // curve, IN
         point *ha // HA, IN
 );
 
@@ -0,0 +1,90 @@
+#ifndef JOS_INC_ENTROPY_H
+#define JOS_INC_ENTROPY_H
+
+#include <inc/types.h>
+
+/* Lock-free single-producer/single-consumer ring of raw entropy samples.
+ *
+ * head and tail are free-running counters, only the producer writes head
+ * and only the consumer writes tail; a slot index is counter & MASK.
+ * credit is the estimated number of entropy bits stored in the ring, it is
+ * increased by the producer and decreased by the consumer.
+ *
+ * A consumer that needs more bits than available publishes the amount in
+ * want and sleeps; the producer clears want once credit reaches it. */
+
+/* Must be a power of two */
+#define ENTROPY_RING_SIZE 64
+#define ENTROPY_RING_MASK (ENTROPY_RING_SIZE - 1)
+
+struct entropy_sample {
+    uint64_t value;
+    uint32_t bits;
+};
+
+struct entropy_ring {
+    struct entropy_sample slot[ENTROPY_RING_SIZE];
+    uint64_t head;
+    uint64_t tail;
+    uint64_t credit;
+    uint64_t want;
+};
+
+/* Producer side. Returns false if the ring is full and the sample was dropped. */
+static inline bool
+entropy_ring_push(struct entropy_ring *r, uint64_t value, uint32_t bits) {
+    uint64_t head = r->head;
+    if (head - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) == ENTROPY_RING_SIZE)
+        return false;
+
+    r->slot[head & ENTROPY_RING_MASK].value = value;
+    r->slot[head & ENTROPY_RING_MASK].bits = bits;
+    __atomic_store_n(&r->head, head + 1, __ATOMIC_RELEASE);
+
+    uint64_t credit = __atomic_add_fetch(&r->credit, bits, __ATOMIC_SEQ_CST);
+    uint64_t want = __atomic_load_n(&r->want, __ATOMIC_SEQ_CST);
+    /* Wake up the consumer */
+    if (want && credit >= want)
+        __atomic_store_n(&r->want, 0, __ATOMIC_RELEASE);
+    return true;
+}
+
+/* Consumer side. Returns false if the ring is empty. */
+static inline bool
+entropy_ring_pop(struct entropy_ring *r, struct entropy_sample *s) {
+    uint64_t tail = r->tail;
+    if (__atomic_load_n(&r->head, __ATOMIC_ACQUIRE) == tail)
+        return false;
+
+    *s = r->slot[tail & ENTROPY_RING_MASK];
+    __atomic_store_n(&r->tail, tail + 1, __ATOMIC_RELEASE);
+    __atomic_sub_fetch(&r->credit, s->bits, __ATOMIC_ACQ_REL);
+    return true;
+}
+
+static inline uint64_t
+entropy_ring_credit(struct entropy_ring *r) {
+    return __atomic_load_n(&r->credit, __ATOMIC_ACQUIRE);
+}
+
+/* Blocks until the ring holds at least {bits} bits of credit.
+ * {sleep} gives the producer a chance to run, it is called only while
+ * the producer has not woken us up yet. {bits} must not exceed what a
+ * full ring can hold, otherwise the producer never wakes us up. */
+static inline void
+entropy_ring_wait(struct entropy_ring *r, uint64_t bits, void (*sleep)(void)) {
+    if (entropy_ring_credit(r) >= bits)
+        return;
+
+    /* Store-load ordering against the producer's credit update and want
+     * load: the producer may have filled the ring before it saw want */
+    __atomic_store_n(&r->want, bits, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&r->credit, __ATOMIC_SEQ_CST) >= bits) {
+        __atomic_store_n(&r->want, 0, __ATOMIC_RELEASE);
+        return;
+    }
+    while (__atomic_load_n(&r->want, __ATOMIC_ACQUIRE))
+        sleep();
+}
+
+#endif /* !JOS_INC_ENTROPY_H */
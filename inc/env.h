@@ -50,6 +50,10 @@ struct List {
     struct List *prev, *next;
 };
 
+/* XSAVE standard format for x87, SSE and AVX: the 512-byte legacy
+ * FXSAVE area, the 64-byte header and the upper halves of the YMM registers */
+#define ENV_FPU_SIZE 832
+
 struct AddressSpace {
     pml4e_t *pml4;     /* Virtual address of pml4 */
     uintptr_t cr3;     /* Physical address of pml4 */
@@ -81,6 +85,9 @@ struct Env {
     uint32_t env_ipc_value;  /* Data value sent to us */
     envid_t env_ipc_from;    /* envid of the sender */
     int env_ipc_perm;        /* Perm of page mapping received */
+
+    /* x87, SSE and AVX registers, saved on every trap */
+    uint8_t env_fpu[ENV_FPU_SIZE] __attribute__((aligned(64)));
 };
 
 #endif /* !JOS_INC_ENV_H */
@@ -88,6 +88,7 @@ int sys_map_region(envid_t src_env, void *src_pg,
 int sys_unmap_region(envid_t env, void *pg, size_t size);
 int sys_ipc_try_send(envid_t to_env, uint64_t value, void *pg, size_t size, int perm);
 int sys_ipc_recv(void *rcv_pg, size_t size);
+int sys_getrandom(void *buf, size_t len);
 
 /* This must be inlined. Exercise for reader: why? */
 static inline envid_t __attribute__((always_inline))
@@ -104,6 +105,9 @@ void ipc_send(envid_t to_env, uint32_t value, void *pg, size_t size, int perm);
 int32_t ipc_recv(envid_t *from_env_store, void *pg, size_t *psize, int *perm_store);
 envid_t ipc_find_env(enum EnvType type);
 
+/* getrandom.c */
+int getrandom(void *buf, size_t len);
+
 /* fork.c */
 envid_t fork(void);
 envid_t sfork(void);
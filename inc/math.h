@@ -8,20 +8,12 @@
 #include <stdint.h>
 #include <stddef.h>
 
-typedef void(*ptr_integral_func)(double x, int param_count, const double *const_params, double *res);
-
 ///Culc abs value
 extern void abs_func(double x, double *res);
 
 ///Culc sqrt
 extern void sqrt_func(double x, double *res);
 
-///Numerical trapezodial integration of {func} from {from} to {to}
-extern void integral_func(double from, double to, double eps, ptr_integral_func func, int param_count, const double *const_params, double *res);
-
-///Calc Gamma(a, z)
-extern void gamma_func(double a, double z, double *res);
-
 ///Calc log2(x)
 extern void log2_func(double x, double *res);
 
@@ -43,7 +35,19 @@ extern void exp_n_func(int32_t n, double *res);
 ///Calc e^st
 extern void exp_func(double st, double *res);
 
+///Calc erf
+extern void erf_func(double x, double *res);
+
 ///Calc erfc
 extern void erfc_func(double x, double *res);
 
+///Calc sin(x) and cos(x)
+extern void sincos_func(double x, double *sin, double *cos);
+
+///Calc log(Gamma(x)) | x >= 1/2
+extern void log_gamma_func(double x, double *res);
+
+///Calc Q(a, x) = Gamma(a, x) / Gamma(a), the regularized upper incomplete gamma
+extern void igamc_func(double a, double x, double *res);
+
 #endif // CRNG_MATH_H
@@ -23,11 +23,131 @@ bool frequency_block_test(unsigned n, unsigned M, uint64_t (*func)());
 bool runs_test(unsigned n, unsigned not_used, uint64_t (*func)());
 
 ///The focus of the test is the longest run of ones within M-bit blocks.
-///Params: n=128, M=8; n=6272, M=128
-//TODO: add n=750.000, M=10.000
+///Params: n=128, M=8; n=6272, M=128; n=750000, M=10000
 bool longest_run_of_ones_test(unsigned n, unsigned M, uint64_t (*func)());
 
 ///The focus of the test is the rank of disjoint sub-matrices of the entire sequence.
+///N = n / (32 * 32) matrices, one after another.
 bool binary_matrix_rank_test(unsigned no_used, unsigned not_used, uint64_t (*func)());
 
+///The tests below read the first n bits of the sequence as a whole and pick
+///their own parameters from n, M is not used.
+
+///The focus of the test is the peak heights in the DFT of the sequence.
+///Runs on the longest power of two prefix, up to NIST_DFT_MAX_BITS bits.
+bool discrete_fourier_transform_test(unsigned n, unsigned not_used, uint64_t (*func)());
+
+///The focus of the test is the number of occurrences of all 148 aperiodic 9-bit templates.
+bool non_overlapping_template_test(unsigned n, unsigned not_used, uint64_t (*func)());
+
+///The focus of the test is the number of occurrences of the 9-bit run of ones, M=1032.
+bool overlapping_template_test(unsigned n, unsigned not_used, uint64_t (*func)());
+
+///The focus of the test is the number of bits between matching L-bit patterns.
+///Needs n >= 387840.
+bool universal_test(unsigned n, unsigned not_used, uint64_t (*func)());
+
+///The focus of the test is the length of the shortest LFSR generating each 500-bit block.
+bool linear_complexity_test(unsigned n, unsigned not_used, uint64_t (*func)());
+
+///The focus of the test is the frequency of all overlapping m-bit patterns, m < log2(n) - 2.
+bool serial_test(unsigned n, unsigned not_used, uint64_t (*func)());
+
+///The focus of the test is the frequency of overlapping m and m+1-bit patterns, m < log2(n) - 5.
+bool approximate_entropy_test(unsigned n, unsigned not_used, uint64_t (*func)());
+
+///The focus of the test is the maximal excursion of the random walk, forward and backward.
+bool cumulative_sums_test(unsigned n, unsigned not_used, uint64_t (*func)());
+
+///The focus of the test is the number of visits to states -4..4 per cycle of the random walk.
+///Needs at least 500 cycles, otherwise it is not applicable.
+bool random_excursions_test(unsigned n, unsigned not_used, uint64_t (*func)());
+
+///The focus of the test is the total number of visits to states -9..9 of the random walk.
+bool random_excursions_variant_test(unsigned n, unsigned not_used, uint64_t (*func)());
+
+///Streaming engine: one sequence feeds every selected test in a single pass.
+///Each test reads a prefix of the same word stream, exactly the words its
+///stand-alone version above pulls from {func}, so results are identical.
+///The sequence tests get the first n bits copied to a buffer and run on it
+///at result time; the buffer and their work space are static, so only one
+///stream at a time may use them.
+enum nist_test {
+    NIST_FREQUENCY,
+    NIST_BLOCK_FREQUENCY,
+    NIST_RUNS,
+    NIST_LONGEST_RUN,
+    NIST_MATRIX_RANK,
+    NIST_DFT,
+    NIST_NON_OVERLAPPING_TEMPLATE,
+    NIST_OVERLAPPING_TEMPLATE,
+    NIST_UNIVERSAL,
+    NIST_LINEAR_COMPLEXITY,
+    NIST_SERIAL,
+    NIST_APPROXIMATE_ENTROPY,
+    NIST_CUMULATIVE_SUMS,
+    NIST_RANDOM_EXCURSIONS,
+    NIST_RANDOM_EXCURSIONS_VARIANT,
+    NIST_NTESTS
+};
+
+#define NIST_ALL_TESTS ((1U << NIST_NTESTS) - 1)
+#define NIST_SEQUENCE_TESTS (NIST_ALL_TESTS & ~((1U << NIST_DFT) - 1))
+///Rank test matrices are 32x32 as in SP 800-22, the engine below also does 64x64
+#define NIST_MATRIX_SIZE 32
+///Rank test matrices eliminated per engine call
+#define NIST_RANK_BATCH 8
+///Longest sequence the sequence tests accept
+#define NIST_MAX_BITS (1U << 20)
+#define NIST_DFT_MAX_BITS (1U << 19)
+
+struct nist_stream {
+    unsigned n, M;
+    unsigned tests;       //selected tests, bit i is enum nist_test i
+    unsigned active;      //selected tests that still want words
+    unsigned skipped;     //selected tests not applicable to this sequence
+    unsigned block_words; //words of one M-bit block
+    struct { unsigned words, ones; } freq;
+    struct { unsigned blocks, pos, ones; double ksi_2; } block;
+    struct { unsigned words, ones, V_n; uint64_t prev; } runs;
+    struct { unsigned blocks, pos, curr_len, max_len; unsigned v[7]; } longest;
+    struct { unsigned matrices, rows, F_M, F_M_1, F_other; uint64_t row[NIST_RANK_BATCH * NIST_MATRIX_SIZE]; } rank;
+    struct { uint64_t *words; unsigned count; } seq;
+    double p_value[NIST_NTESTS]; //set by nist_stream_result(), the first one for tests with several
+};
+
+extern const char *const nist_test_names[NIST_NTESTS];
+
+void nist_stream_init(struct nist_stream *s, unsigned n, unsigned M, unsigned tests);
+///Feeds the next {count} words of the sequence to every test still active
+void nist_stream_feed(struct nist_stream *s, const uint64_t *words, size_t count);
+///Bit i is set if test i was selected, got all its words and passed.
+///Tests found not applicable are left out and marked in s->skipped.
+unsigned nist_stream_result(struct nist_stream *s);
+///Generates one sequence in chunks with {fill} and runs {tests} over it,
+///{skipped} gets the tests that were not applicable, {p_values} gets
+///NIST_NTESTS p-values, both may be NULL
+unsigned nist_stream_run(unsigned n, unsigned M, unsigned tests, void (*fill)(void *, size_t), unsigned *skipped,
+                         double *p_values);
+
+///Significance level of every test
+#define NIST_ALPHA 0.01
+///Bins of the p-value uniformity histogram
+#define NIST_HIST_BINS 10
+///Uniformity p-value below which a test's p-values are not uniform
+#define NIST_UNIFORMITY_ALPHA 0.0001
+
+///True if {failed} of {total} p-values below NIST_ALPHA is within the
+///NIST proportion confidence interval
+bool nist_proportion_pass(unsigned failed, unsigned total);
+///Counts {p} in its histogram bin
+void nist_histogram_add(unsigned bins[NIST_HIST_BINS], double p);
+///Chi-square uniformity p-value of a p-value histogram
+void nist_uniformity(const unsigned bins[NIST_HIST_BINS], double *res);
+
+///GF(2) rank of {count} size x size matrices, size is 32 or 64. Bit j of a
+///row is column j, the rows of a matrix follow each other in {rows} and are
+///eliminated in place. Reentrant.
+void gf2_rank(uint64_t *rows, unsigned size, unsigned count, unsigned *ranks);
+
 #endif // OSCOURSE_NIST_H
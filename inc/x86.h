@@ -171,6 +171,43 @@ rcr4(void) {
     return cr4;
 }
 
+static inline uint64_t __attribute__((always_inline))
+xgetbv(uint32_t index) {
+    uint32_t lo, hi;
+    asm volatile("xgetbv"
+                 : "=a"(lo), "=d"(hi)
+                 : "c"(index));
+    return (uint64_t)lo | ((uint64_t)hi << 32);
+}
+
+static inline void __attribute__((always_inline))
+xsetbv(uint32_t index, uint64_t val) {
+    asm volatile("xsetbv" ::"c"(index), "a"((uint32_t)val), "d"((uint32_t)(val >> 32)));
+}
+
+static inline void __attribute__((always_inline))
+fxsave(void *area) {
+    asm volatile("fxsave64 %0"
+                 : "=m"(*(uint8_t(*)[512])area));
+}
+
+static inline void __attribute__((always_inline))
+fxrstor(const void *area) {
+    asm volatile("fxrstor64 %0" ::"m"(*(const uint8_t(*)[512])area));
+}
+
+static inline void __attribute__((always_inline))
+xsave(void *area, uint64_t mask) {
+    asm volatile("xsave64 (%0)" ::"r"(area), "a"((uint32_t)mask), "d"((uint32_t)(mask >> 32))
+                 : "memory");
+}
+
+static inline void __attribute__((always_inline))
+xrstor(const void *area, uint64_t mask) {
+    asm volatile("xrstor64 (%0)" ::"r"(area), "a"((uint32_t)mask), "d"((uint32_t)(mask >> 32))
+                 : "memory");
+}
+
 static inline uint64_t __attribute__((always_inline))
 rdmsr(uint32_t msr) {
     uint64_t rax, rdx;
@@ -245,6 +282,19 @@ cpuid(uint32_t info, uint32_t *raxp, uint32_t *rbxp, uint32_t *rcxp, uint32_t *r
     if (rdxp) *rdxp = edx;
 }
 
+/* cpuid for leaves with sub-leaves (e.g. 7), {subleaf} goes to ecx */
+static inline void __attribute__((always_inline))
+cpuid_count(uint32_t info, uint32_t subleaf, uint32_t *raxp, uint32_t *rbxp, uint32_t *rcxp, uint32_t *rdxp) {
+    uint32_t eax, ebx, ecx, edx;
+    asm volatile("cpuid"
+                 : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx)
+                 : "a"(info), "c"(subleaf));
+    if (raxp) *raxp = eax;
+    if (rbxp) *rbxp = ebx;
+    if (rcxp) *rcxp = ecx;
+    if (rdxp) *rdxp = edx;
+}
+
 static inline uint64_t __attribute__((always_inline))
 read_tsc(void) {
     uint32_t lo, hi;
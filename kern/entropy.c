@@ -0,0 +1,38 @@
+/* Central kernel entropy pool.
+ *
+ * Every user environment used to seed its own generator; now the kernel
+ * keeps one ISAAC stream that serves SYS_getrandom. It is seeded (and
+ * periodically reseeded) from RDSEED, topped up with whatever scheduler
+ * timing entropy is already collected, and finally RDRAND or the doom
+ * path for the remaining words. */
+
+#include <inc/crng.h>
+#include <inc/entropy.h>
+#include <kern/entropy.h>
+
+extern struct entropy_ring sched_entropy;
+
+static struct isaac_stream entropy_pool;
+static bool entropy_pool_ready = 0;
+
+/* Non-blocking: only uses scheduler samples that are already there */
+static size_t
+entropy_pool_harvest(uint64_t *words, size_t n) {
+    size_t i = crng_rdseed_harvest(words, n);
+    while (i < n && entropy_ring_credit(&sched_entropy) >= DOOM_SEED_BITS) {
+        words[i++] = secure_rand64_doom();
+    }
+    return i;
+}
+
+void
+entropy_pool_init(void) {
+    isaac_stream_init(&entropy_pool, secure_rand64_rdrand, entropy_pool_harvest);
+    entropy_pool_ready = 1;
+}
+
+void
+entropy_pool_fill(void *buf, size_t len) {
+    if (!entropy_pool_ready) entropy_pool_init();
+    isaac_stream_fill(&entropy_pool, buf, len);
+}
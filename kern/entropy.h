@@ -0,0 +1,17 @@
+/* See COPYRIGHT for copyright information. */
+
+#ifndef JOS_KERN_ENTROPY_H
+#define JOS_KERN_ENTROPY_H
+#ifndef JOS_KERNEL
+#error "This is a JOS kernel header; user programs should not #include it"
+#endif
+
+#include <inc/types.h>
+
+/* Largest request served by a single SYS_getrandom */
+#define GETRANDOM_MAX (1UL << 20)
+
+void entropy_pool_init(void);
+void entropy_pool_fill(void *buf, size_t len);
+
+#endif /* !JOS_KERN_ENTROPY_H */
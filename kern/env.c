@@ -33,6 +33,11 @@ struct Env *envs = NULL;
  * (linked by Env->env_link) */
 static struct Env *env_free_list;
 
+/* Set by env_init() when simd_init() enabled XSAVE and AVX state,
+ * otherwise the FPU state is the FXSAVE legacy area alone */
+static bool env_fpu_xsave;
+#define ENV_FPU_XCR0 7 /* x87, SSE and AVX */
+
 
 /* NOTE: Should be at least LOGNENV */
 #define ENVGENSHIFT 12
@@ -94,8 +99,10 @@ env_init(void) {
      * (don't forget about rounding) */
 
     // LAB 8: Your code here
+    static_assert(sizeof(*envs) * NENV <= UENVS_SIZE, "envs do not fit UENVS");
     envs = (struct Env *)kzalloc_region(sizeof(*envs) * NENV);
     memset(envs, 0, sizeof(*envs) * NENV);
+    env_fpu_xsave = !!(rcr4() & CR4_OSXSAVE);
 
     /* Map envs to UENVS read-only,
      * but user-accessible (with PROT_USER_ set) */
@@ -157,6 +164,13 @@ env_alloc(struct Env **newenv_store, envid_t parent_id, enum EnvType type) {
      * from "leaking" into our new environment */
     memset(&env->env_tf, 0, sizeof(env->env_tf));
 
+    /* FPU state as after fninit, with every SSE exception masked.
+     * An all-zero XSAVE header makes xrstor load the init state of
+     * every component but MXCSR. */
+    memset(env->env_fpu, 0, sizeof(env->env_fpu));
+    *(uint16_t *)&env->env_fpu[0] = 0x37F; /* FCW */
+    *(uint32_t *)&env->env_fpu[24] = 0x1F80; /* MXCSR */
+
     /* Set up appropriate initial values for the segment registers.
      * GD_UD is the user data (KD - kernel data) segment selector in the GDT, and
      * GD_UT is the user text (KT - kernel text) segment selector (see inc/memlayout.h).
@@ -405,6 +419,25 @@ csys_yield(struct Trapframe *tf) {
 }
 #endif
 
+/* The timer preempts environments in the middle of floating point code,
+ * so their x87, SSE and AVX registers are saved by trap() with
+ * env_save_fpu() and put back by env_run() */
+void
+env_save_fpu(struct Env *env) {
+    if (env_fpu_xsave)
+        xsave(env->env_fpu, ENV_FPU_XCR0);
+    else
+        fxsave(env->env_fpu);
+}
+
+static void
+env_restore_fpu(struct Env *env) {
+    if (env_fpu_xsave)
+        xrstor(env->env_fpu, ENV_FPU_XCR0);
+    else
+        fxrstor(env->env_fpu);
+}
+
 /* Restores the register values in the Trapframe with the 'ret' instruction.
  * This exits the kernel and starts executing some environment's code.
  *
@@ -484,6 +517,7 @@ env_run(struct Env *env) {
     // LAB 8: Your code here
     switch_address_space(&curenv->address_space);
     // Your code here end
+    env_restore_fpu(curenv);
     env_pop_tf(&(curenv->env_tf));
     while(1) {}
 }
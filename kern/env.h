@@ -22,6 +22,7 @@ void env_destroy(struct Env *env);
 int envid2env(envid_t envid, struct Env **env_store, bool checkperm);
 _Noreturn void env_run(struct Env *e);
 _Noreturn void env_pop_tf(struct Trapframe *tf);
+void env_save_fpu(struct Env *env);
 
 #ifdef CONFIG_KSPACE
 extern void sys_exit(void);
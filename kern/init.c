@@ -5,6 +5,9 @@
 #include <inc/assert.h>
 #include <inc/uefi.h>
 #include <inc/memlayout.h>
+#include <inc/crng.h>
+#include <inc/x86.h>
+#include <inc/mmu.h>
 
 #include <kern/monitor.h>
 #include <kern/tsc.h>
@@ -100,6 +103,24 @@ map_shadow_early_boot(uintptr_t va, uintptr_t sz, void *page) {
 
 extern char end[];
 
+/* Enables SSE and, when present, AVX register state for the ChaCha20
+ * kernels. Everything else is built with -mno-sse but still does x87
+ * floating point; env_save_fpu() keeps all of it per environment. */
+static void
+simd_init(void) {
+    uint32_t ecx, edx;
+    cpuid(1, NULL, NULL, &ecx, &edx);
+    if (!((edx >> 25) & 1)) return;
+
+    lcr4(rcr4() | CR4_OSFXSR | CR4_OSXMMEXCPT);
+
+    /* XSAVE and AVX: XCR0 must enable x87, SSE and AVX state together */
+    if (((ecx >> 26) & 1) && ((ecx >> 28) & 1)) {
+        lcr4(rcr4() | CR4_OSXSAVE);
+        xsetbv(0, xgetbv(0) | 7);
+    }
+}
+
 /* Additionally maps pml4 memory so that we dont get memory errors on accessing
  * uefi_lp, MemMap, KASAN functions. */
 void
@@ -136,6 +157,9 @@ i386_init(void) {
 
     tsc_calibrate();
 
+    /* Probe RDRAND/RDSEED once instead of on every random number */
+    crng_hw_init();
+
     if (trace_init) {
         cprintf("6828 decimal is %o octal!\n", 6828);
         cprintf("END: %p\n", end);
@@ -143,6 +167,8 @@ i386_init(void) {
 
     /* Lab 6 memory management initialization functions */
     init_memory();
+    /* After init_memory(): it reloads cr4 */
+    simd_init();
 
     pic_init();
     rtc_timer_init();
@@ -10,6 +10,7 @@
 #include <inc/crng.h>
 #include <inc/nist.h>
 #include <inc/ecdsa.h>
+#include <inc/math.h>
 
 #include <kern/console.h>
 #include <kern/monitor.h>
@@ -24,7 +25,7 @@
 #define WHITESPACE "\t\r\n "
 #define MAXARGS    16
 
-extern curve p_192;
+extern curve p_192, p_224, p_256, p_384;
 
 /* Functions implementing monitor commands */
 int mon_help(int argc, char **argv, struct Trapframe *tf);
@@ -43,6 +44,13 @@ int mon_crng_test(int argc, char **argv, struct Trapframe *tf);
 int mon_ecdsa_test(int argc, char **argv, struct Trapframe *tf);
 int mon_make_random(int argc, char **argv, struct Trapframe *tf);
 int mon_crng_test_restart(int argc, char **argv, struct Trapframe *tf);
+int mon_crng_hw(int argc, char **argv, struct Trapframe *tf);
+int mon_crng_bbs(int argc, char **argv, struct Trapframe *tf);
+int mon_crng_backend(int argc, char **argv, struct Trapframe *tf);
+int mon_crng_bench(int argc, char **argv, struct Trapframe *tf);
+int mon_math_test(int argc, char **argv, struct Trapframe *tf);
+int mon_ecdsa_bench(int argc, char **argv, struct Trapframe *tf);
+int mon_bn_bench(int argc, char **argv, struct Trapframe *tf);
 
 struct Command {
     const char *name;
@@ -67,7 +75,14 @@ static struct Command commands[] = {
         {"crng_test", "Test crng", mon_crng_test},
         {"ecdsa_test", "Test ecdsa", mon_ecdsa_test},
         {"make_random", "Get 49 nums", mon_make_random},
-        {"mon_crng_test_restart", "Restast system test", mon_crng_test_restart}
+        {"mon_crng_test_restart", "Restast system test", mon_crng_test_restart},
+        {"crng_hw", "Show hardware entropy counters, 'reseed' reseeds ISAAC with RDSEED", mon_crng_hw},
+        {"crng_bbs", "Compare BBS bits/second: 1024-bit Montgomery vs 64-bit modulus", mon_crng_bbs},
+        {"crng_backend", "Show or select the crng_fill() backend and the ChaCha20 kernel", mon_crng_backend},
+        {"crng_bench", "Benchmark generators: cycles/byte, MB/s, p50/p99 latency; optional backend name", mon_crng_bench},
+        {"math_test", "Check igamc/erfc/sqrt against reference values and time them", mon_math_test},
+        {"ecdsa_bench", "Time ECDSA key generation, signing and verification on P-192..P-384 [comb teeth]", mon_ecdsa_bench},
+        {"bn_bench", "Time bignum products and reductions at 192..1024 bits", mon_bn_bench}
 };
 #define NCOMMANDS (sizeof(commands) / sizeof(commands[0]))
 
@@ -219,48 +234,37 @@ int mon_make_random(int argc, char **argv, struct Trapframe *tf) {
 }
 
 int mon_crng_test(int argc, char **argv, struct Trapframe *tf) {
-    uint64_t (*tested_function)() = secure_urand64_rdrand;
-    int tests_size = 200, count = 0;
-    unsigned n = 750000, M = 10000;
+    const struct crng_backend *backend = crng_backend_find("rdrand");
+    int tests_size = 200;
+    unsigned n = 750000, M = 10000, passed[NIST_NTESTS] = {0}, skipped[NIST_NTESTS] = {0};
     if (argc < 2) {
-        cprintf("No tested function specified, leave by default: secure_urand64_rdrand\n");
-        cprintf("Testing CPRNG with hardware entropy(n size: %u, M size: %u):\n", n, M);
-    } else if (!strcmp(argv[1], "rdrand")) {
-        tested_function = secure_urand64_rdrand;
-        cprintf("Testing CPRNG with hardware entropy(n size: %u, M size: %u):\n", n, M);
-    } else if (!strcmp(argv[1], "doom")) {
-        tested_function = secure_urand64_doom;
-        cprintf("Testing CPRNG with fake entropy(n size: %u, M size: %u):\n", n, M);
-    } else {
+        cprintf("No tested function specified, leave by default: rdrand\n");
+    } else if (!(backend = crng_backend_find(argv[1]))) {
         cprintf("Unknown function, terminate testing\n");
         return 1;
     }
-    bool (*test_function[5])(unsigned, unsigned, uint64_t (*)()) = {
-        frequency_test,
-        frequency_block_test,
-        runs_test,
-        longest_run_of_ones_test,
-        binary_matrix_rank_test
-    };
-    const char *test_function_name[5] = {
-        "Frequency test",
-        "Frequency block test",
-        "Runs test",
-        "Longest run of ones test",
-        "Binary matrix rank test"
-    };
-    for (int test_count = 0; test_count < sizeof(test_function) / sizeof(test_function[0]); test_count++) {
-        cprintf("-%s:\n--Testing", test_function_name[test_count]);
-        for (int i = 1; i <= tests_size; i++) {
-            if (test_function[test_count](n, M, tested_function)) {
-                count += 1;
-            }
-            if (i % (tests_size / 10) == 0) {
-                cprintf(".");
-            }
+    cprintf("Testing CPRNG %s (n size: %u, M size: %u):\n", backend->name, n, M);
+
+    /* Every sequence is generated once and feeds all tests */
+    cprintf("--Testing");
+    for (int i = 1; i <= tests_size; i++) {
+        unsigned not_applicable;
+        unsigned result = nist_stream_run(n, M, NIST_ALL_TESTS, backend->fill, &not_applicable, NULL);
+        for (int test = 0; test < NIST_NTESTS; test++) {
+            passed[test] += (result >> test) & 1;
+            skipped[test] += (not_applicable >> test) & 1;
         }
-        cprintf("OK\n--Result: %d/%d tests passed\n", count, tests_size);
-        count = 0;
+        if (i % (tests_size / 10) == 0) {
+            cprintf(".");
+        }
+    }
+    cprintf("OK\n");
+    for (int test = 0; test < NIST_NTESTS; test++) {
+        cprintf("-%s:\n--Result: %u/%u tests passed", nist_test_names[test], passed[test], tests_size - skipped[test]);
+        if (skipped[test]) {
+            cprintf(" (%u not applicable)", skipped[test]);
+        }
+        cprintf("\n");
     }
     return 0;
 }
@@ -279,15 +283,18 @@ mon_ecdsa_test(int argc, char **argv, struct Trapframe *tf) {
     md5(message, len, hash);
     convert_from_md5_to_bignum(&z, hash);
 
+    static ecdsa_curve ec;
+    ecdsa_curve_init(&ec, &p_192);
+
     point HA;
     bignum k, s, r, dA;
     bignum_from_int(&k, 7);
     bignum_from_int(&dA, 11);
 
-    ecdsa_sign(&p_192, &z, &dA, &r, &s);
-    ecdsa_public_key(&dA, &p_192, &HA);
+    ecdsa_sign(&ec, &z, &dA, &r, &s);
+    ecdsa_public_key(&dA, &ec, &HA);
 
-    int result = ecdsa_verify(&z, &r, &s, &p_192, &HA);
+    int result = ecdsa_verify(&z, &r, &s, &ec, &HA);
 
     cprintf("Check signature test: ");
     if (result == 1)
@@ -304,7 +311,7 @@ mon_ecdsa_test(int argc, char **argv, struct Trapframe *tf) {
     modified_HA.zero_flag = 0;
     bignum_inc(&modified_HA.x);
 
-    result = ecdsa_verify(&z, &r, &s, &p_192, &modified_HA);
+    result = ecdsa_verify(&z, &r, &s, &ec, &modified_HA);
 
     cprintf("Check fake public key test: ");
     if (result == 0)
@@ -320,7 +327,7 @@ mon_ecdsa_test(int argc, char **argv, struct Trapframe *tf) {
     md5((char*)modified_message, len, hash);
     convert_from_md5_to_bignum(&z, hash);
 
-    result = ecdsa_verify(&z, &r, &s, &p_192, &modified_HA);
+    result = ecdsa_verify(&z, &r, &s, &ec, &modified_HA);
 
     cprintf("Check wrong message test: ");
     if (result == 0)
@@ -369,6 +376,402 @@ mon_crng_doom(int argc, char **argv, struct Trapframe *tf) {
     return 0;
 }
 
+int
+mon_crng_hw(int argc, char **argv, struct Trapframe *tf) {
+    if (argc > 1 && !strcmp(argv[1], "reseed")) {
+        crng_reseed_rdseed();
+    }
+    cprintf("rdrand: %s, rdseed: %s\n",
+            crng_has_rdrand() ? "yes" : "no", crng_has_rdseed() ? "yes" : "no");
+    cprintf("  rdrand retries %lu, failures %lu\n",
+            (unsigned long)crng_hw_stats.rdrand_retries, (unsigned long)crng_hw_stats.rdrand_failures);
+    cprintf("  rdseed retries %lu, failures %lu, words %lu\n",
+            (unsigned long)crng_hw_stats.rdseed_retries, (unsigned long)crng_hw_stats.rdseed_failures,
+            (unsigned long)crng_hw_stats.rdseed_words);
+    cprintf("  doom fallbacks %lu\n", (unsigned long)crng_hw_stats.doom_fallbacks);
+    return 0;
+}
+
+/* crng_bench: every path is timed call by call with the TSC. A first,
+ * untimed call seeds the generator and estimates how many calls fit in
+ * CRNG_BENCH_CYCLES, so slow paths (BBS, scheduler entropy) stay short. */
+#define CRNG_BENCH_CALLS  1024
+#define CRNG_BENCH_CYCLES (1ULL << 28)
+
+static uint64_t crng_bench_lat[CRNG_BENCH_CALLS];
+static uint8_t crng_bench_buf[1 << 16];
+static const size_t crng_bench_sizes[] = {16, 256, 4096, sizeof(crng_bench_buf)};
+static uint64_t crng_bench_sink;
+
+static void
+crng_bench_sort(uint64_t *a, unsigned n) {
+    for (unsigned i = 1; i < n; i++) {
+        uint64_t v = a[i];
+        unsigned j = i;
+        for (; j > 0 && a[j - 1] > v; j--) {
+            a[j] = a[j - 1];
+        }
+        a[j] = v;
+    }
+}
+
+/* Times {word} (8 bytes per call) or a {size} byte {fill} */
+static void
+crng_bench_run(const char *name, uint64_t (*word)(void), void (*fill)(void *, size_t),
+               size_t size, uint64_t freq) {
+    uint64_t start, total = 0;
+    unsigned calls;
+
+    start = read_tsc();
+    if (word) crng_bench_sink ^= word();
+    else fill(crng_bench_buf, size);
+    total = read_tsc() - start;
+    calls = total ? CRNG_BENCH_CYCLES / total : CRNG_BENCH_CALLS;
+    if (calls > CRNG_BENCH_CALLS) calls = CRNG_BENCH_CALLS;
+    if (!calls) calls = 1;
+
+    total = 0;
+    for (unsigned i = 0; i < calls; i++) {
+        start = read_tsc();
+        if (word) crng_bench_sink ^= word();
+        else fill(crng_bench_buf, size);
+        crng_bench_lat[i] = read_tsc() - start;
+        total += crng_bench_lat[i];
+    }
+    crng_bench_sort(crng_bench_lat, calls);
+
+    uint64_t bytes = (uint64_t)size * calls;
+    uint64_t cpb = total * 100 / bytes;
+    uint64_t mbps = total ? bytes * freq / total / 1000000 : 0;
+    cprintf("%-16s %6lu %5u %6lu.%02lu %7lu %9lu %9lu\n", name, (unsigned long)size, calls,
+            (unsigned long)(cpb / 100), (unsigned long)(cpb % 100), (unsigned long)mbps,
+            (unsigned long)crng_bench_lat[calls / 2], (unsigned long)crng_bench_lat[calls * 99 / 100]);
+}
+
+int
+mon_crng_bench(int argc, char **argv, struct Trapframe *tf) {
+    uint64_t freq = tsc_calibrate();
+    const char *only = argc > 1 ? argv[1] : NULL;
+    char name[32];
+
+    cprintf("%-16s %6s %5s %9s %7s %9s %9s\n", "path", "bytes", "calls", "cyc/B", "MB/s", "p50", "p99");
+
+    /* Seed paths */
+    if (!only || !strcmp(only, "rdrand"))
+        crng_bench_run("rdrand seed", secure_rand64_rdrand, NULL, sizeof(uint64_t), freq);
+    if (!only || !strcmp(only, "doom"))
+        crng_bench_run("doom seed", secure_rand64_doom, NULL, sizeof(uint64_t), freq);
+
+    /* Unbuffered reference paths */
+    if (!only || !strcmp(only, "rdrand"))
+        crng_bench_run("rdrand refill", secure_urand64_rdrand_refill, NULL, sizeof(uint64_t), freq);
+    if (!only || !strcmp(only, "doom"))
+        crng_bench_run("doom bbs64", secure_urand64_doom_bbs64, NULL, sizeof(uint64_t), freq);
+
+    /* Buffered word paths and bulk fills */
+    for (int i = 0; i < CRNG_NBACKENDS; i++) {
+        const struct crng_backend *b = &crng_backends[i];
+        if (only && strcmp(only, b->name)) continue;
+
+        snprintf(name, sizeof(name), "%s urand64", b->name);
+        crng_bench_run(name, b->urand64, NULL, sizeof(uint64_t), freq);
+        for (size_t j = 0; j < sizeof(crng_bench_sizes) / sizeof(*crng_bench_sizes); j++) {
+            snprintf(name, sizeof(name), "%s fill", b->name);
+            crng_bench_run(name, NULL, b->fill, crng_bench_sizes[j], freq);
+        }
+    }
+    cprintf("checksum %lx, TSC %lu Hz\n", (unsigned long)crng_bench_sink, (unsigned long)freq);
+    return 0;
+}
+
+int
+mon_crng_backend(int argc, char **argv, struct Trapframe *tf) {
+    for (int i = 1; i < argc; i++) {
+        bool found = crng_backend_select(argv[i]);
+        for (int impl = 0; !found && impl < CHACHA20_NIMPL; impl++) {
+            if (!strcmp(argv[i], chacha20_impl_name(impl))) {
+                if (!chacha20_set_impl(impl)) {
+                    cprintf("%s is not supported\n", argv[i]);
+                }
+                found = 1;
+            }
+        }
+        if (!found) {
+            cprintf("Unknown backend or kernel '%s'\n", argv[i]);
+        }
+    }
+
+    cprintf("backends:");
+    for (int i = 0; i < CRNG_NBACKENDS; i++) {
+        cprintf(" %s%s", crng_backends[i].name, &crng_backends[i] == crng_backend() ? "*" : "");
+    }
+    cprintf("\nchacha20 kernels:");
+    for (int impl = 0; impl < CHACHA20_NIMPL; impl++) {
+        if (chacha20_impl_supported(impl)) {
+            cprintf(" %s%s", chacha20_impl_name(impl), impl == chacha20_get_impl() ? "*" : "");
+        }
+    }
+    cprintf("\n");
+    return 0;
+}
+
+int
+mon_crng_bbs(int argc, char **argv, struct Trapframe *tf) {
+    const unsigned words = 256;
+    uint64_t sink = 0, start, big, small, freq = tsc_calibrate();
+
+    /* Seed outside of the measured region */
+    sink ^= secure_urand64_doom();
+    sink ^= secure_urand64_doom_bbs64();
+
+    start = read_tsc();
+    for (unsigned i = 0; i < words; i++) {
+        sink ^= secure_urand64_doom();
+    }
+    big = read_tsc() - start;
+
+    start = read_tsc();
+    for (unsigned i = 0; i < words; i++) {
+        sink ^= secure_urand64_doom_bbs64();
+    }
+    small = read_tsc() - start;
+
+    cprintf("BBS, %u words (checksum %lx):\n", words, (unsigned long)sink);
+    cprintf("  1024-bit: %lu cycles/word, %lu bits/s\n", (unsigned long)(big / words),
+            (unsigned long)(64 * words * freq / (big ? big : 1)));
+    cprintf("  64-bit:   %lu cycles/word, %lu bits/s\n", (unsigned long)(small / words),
+            (unsigned long)(64 * words * freq / (small ? small : 1)));
+    return 0;
+}
+
+/* math_test: reference values were computed with 60-digit decimal arithmetic,
+ * rounded to double. The worst relative error is printed as decimal digits. */
+#define MATH_TEST_DIGITS 12
+
+static const struct {
+    double a, x, ref;
+} math_test_igamc[] = {
+        {0.5, 0.01, 8.87537083981715158e-01}, {0.5, 0.5, 3.17310507862914093e-01},
+        {0.5, 1, 1.57299207050285134e-01}, {0.5, 2, 4.55002638963584172e-02},
+        {0.5, 4, 4.67773498104726623e-03}, {1.0, 0.5, 6.06530659712633424e-01},
+        {1.0, 2.302585, 1.00000009299405002e-01}, {1.0, 20, 2.06115362243855787e-09},
+        {1.5, 1.5, 3.91625176271088948e-01}, {1.5, 5, 1.85661354630432332e-02},
+        {2.5, 3.2, 2.69218798987103602e-01}, {2.5, 10, 1.24973056303137532e-03},
+        {3.0, 1.5, 8.08846830538058170e-01}, {3.0, 12.5, 3.41454596891708248e-04},
+        {4.0, 9, 2.12264863029088813e-02}, {4.0, 2, 8.57123460498547041e-01},
+        {37.5, 30, 8.96534794802132717e-01}, {37.5, 50, 2.84903295534724953e-02},
+        {37.5, 40, 3.25027605482742010e-01}, {4096.0, 4000, 9.34051471777978426e-01},
+        {4096.0, 4096, 4.97922172806215424e-01}, {4096.0, 4300, 8.41125462548076414e-04},
+        {32768.0, 32768, 4.99265378021881367e-01}, {32768.0, 33300, 1.72230494408141767e-03},
+        {32768.0, 32000, 9.99990417448989088e-01},
+};
+
+static const struct {
+    double x, ref;
+} math_test_erfc[] = {
+        {-3, 1.99997790950300147e+00}, {-1, 1.84270079294971478e+00},
+        {-0.5, 1.52049987781304652e+00}, {0, 1.0},
+        {0.1, 8.87537083981715158e-01}, {0.5, 4.79500122186953481e-01},
+        {0.9, 2.03091787577167865e-01}, {1, 1.57299207050285134e-01},
+        {1.5, 3.38948535246892738e-02}, {2, 4.67773498104726623e-03},
+        {3, 2.20904969985854412e-05}, {5, 1.53745979442803494e-12},
+        {8, 1.12242971729829264e-29}, {10, 2.08848758376254488e-45},
+        {20, 5.39586561160790118e-176}, {26, 5.66319240885614319e-296},
+}, math_test_sqrt[] = {
+        {2, 1.41421356237309515e+00}, {0.5, 7.07106781186547573e-01},
+        {1e-10, 1.00000000000000008e-05}, {750000, 8.66025403784438595e+02},
+        {1048576, 1024}, {3, 1.73205080756887719e+00},
+        {123456.789, 3.51364182864446207e+02},
+};
+
+/* Folds the relative error of {res} into {worst} */
+static void
+math_test_error(double res, double ref, double *worst) {
+    double err;
+    abs_func((res - ref) / ref, &err);
+    if (err > *worst) *worst = err;
+}
+
+static bool
+math_test_report(const char *name, double worst, unsigned count, uint64_t cycles) {
+    int digits = 17;
+    if (worst > 0) {
+        double log_err;
+        log_func(worst, &log_err);
+        digits = (int)(-log_err / 2.30258509299404568402);
+        if (digits > 17) digits = 17;
+    }
+    bool ok = digits >= MATH_TEST_DIGITS;
+    cprintf("%-6s %2u values, %2d digits, %6lu cycles/call: %s\n", name, count, digits,
+            (unsigned long)(cycles / count), ok ? "ok" : "FAILED");
+    return ok;
+}
+
+int
+mon_math_test(int argc, char **argv, struct Trapframe *tf) {
+    const unsigned n_igamc = sizeof(math_test_igamc) / sizeof(*math_test_igamc);
+    const unsigned n_erfc = sizeof(math_test_erfc) / sizeof(*math_test_erfc);
+    const unsigned n_sqrt = sizeof(math_test_sqrt) / sizeof(*math_test_sqrt);
+    double res, worst;
+    uint64_t start, cycles;
+    bool ok = 1;
+
+    worst = 0, cycles = 0;
+    for (unsigned i = 0; i < n_igamc; i++) {
+        start = read_tsc();
+        igamc_func(math_test_igamc[i].a, math_test_igamc[i].x, &res);
+        cycles += read_tsc() - start;
+        math_test_error(res, math_test_igamc[i].ref, &worst);
+    }
+    ok &= math_test_report("igamc", worst, n_igamc, cycles);
+
+    worst = 0, cycles = 0;
+    for (unsigned i = 0; i < n_erfc; i++) {
+        start = read_tsc();
+        erfc_func(math_test_erfc[i].x, &res);
+        cycles += read_tsc() - start;
+        math_test_error(res, math_test_erfc[i].ref, &worst);
+    }
+    ok &= math_test_report("erfc", worst, n_erfc, cycles);
+
+    worst = 0, cycles = 0;
+    for (unsigned i = 0; i < n_sqrt; i++) {
+        start = read_tsc();
+        sqrt_func(math_test_sqrt[i].x, &res);
+        cycles += read_tsc() - start;
+        math_test_error(res, math_test_sqrt[i].ref, &worst);
+    }
+    ok &= math_test_report("sqrt", worst, n_sqrt, cycles);
+
+    cprintf("math_test %s\n", ok ? "passed" : "FAILED");
+    return 0;
+}
+
+/* ecdsa_bench: one key pair per curve, cycles of every operation, init
+ * is the one-off parse of the curve into its context with the comb table
+ * of G. An argument sets ecdsa_comb_teeth, the table size to try. */
+static const struct {
+    const char *name;
+    curve *ellip;
+} ecdsa_bench_curves[] = {
+        {"P-192", &p_192},
+        {"P-224", &p_224},
+        {"P-256", &p_256},
+        {"P-384", &p_384},
+};
+
+int
+mon_ecdsa_bench(int argc, char **argv, struct Trapframe *tf) {
+    const unsigned rounds = 4;
+    char hash[HASHSIZE];
+    static ecdsa_curve ec;
+
+    if (argc > 1)
+        ecdsa_comb_teeth = MIN(MAX(strtol(argv[1], NULL, 0), 1), CURVE_COMB_MAX_TEETH);
+
+    md5("ecdsa_bench", strlen("ecdsa_bench"), hash);
+    cprintf("comb of G: %d teeth, %d points\n", ecdsa_comb_teeth, (1 << ecdsa_comb_teeth) - 1);
+    cprintf("%-6s %12s %12s %12s %12s %s\n", "curve", "init", "keygen", "sign", "verify", "(kcycles)");
+    for (size_t i = 0; i < sizeof(ecdsa_bench_curves) / sizeof(*ecdsa_bench_curves); i++) {
+        bignum z, dA, r, s;
+        point HA;
+        uint64_t start, init, keygen, sign = 0, verify = 0;
+        bool ok = 1;
+
+        convert_from_md5_to_bignum(&z, hash);
+        bignum_from_int(&dA, 0x5eed + i);
+
+        start = read_tsc();
+        ecdsa_curve_init(&ec, ecdsa_bench_curves[i].ellip);
+        init = read_tsc() - start;
+        start = read_tsc();
+        ecdsa_public_key(&dA, &ec, &HA);
+        keygen = read_tsc() - start;
+        for (unsigned j = 0; j < rounds; j++) {
+            start = read_tsc();
+            ecdsa_sign(&ec, &z, &dA, &r, &s);
+            sign += read_tsc() - start;
+            start = read_tsc();
+            ok &= ecdsa_verify(&z, &r, &s, &ec, &HA) == 1;
+            verify += read_tsc() - start;
+        }
+        cprintf("%-6s %12lu %12lu %12lu %12lu %s\n", ecdsa_bench_curves[i].name, (unsigned long)(init / 1000),
+                (unsigned long)(keygen / 1000), (unsigned long)(sign / rounds / 1000),
+                (unsigned long)(verify / rounds / 1000), ok ? "ok" : "FAILED");
+    }
+    return 0;
+}
+
+/* bn_bench: cycles per call for every fixed width, the Karatsuba columns
+ * force the split down to 4 limbs, which is how bn_karatsuba_words was
+ * chosen. mod divides a double width product (Algorithm D), mul_mod
+ * multiplies and reduces it through a Barrett context, mont_mul is the
+ * Montgomery product. The modulus is 2^bits - 1, the operands are below it. */
+#define BN_BENCH_ROUNDS 256
+
+#define BN_BENCH_TIME(expr) ({                                  \
+    uint64_t start_ = read_tsc();                               \
+    for (unsigned r_ = 0; r_ < BN_BENCH_ROUNDS; r_++) expr;     \
+    (unsigned long)((read_tsc() - start_) / BN_BENCH_ROUNDS);   \
+})
+
+#define BN_BENCH_WIDTH(bits)                                                                   \
+    static void                                                                                \
+    bn_bench_##bits(const bignum *x, const bignum *y, const bignum *ones) {                    \
+        bn##bits a, b, m, c;                                                                   \
+        bn##bits##w prod;                                                                      \
+        bn##bits##_barrett ctx;                                                                \
+        bn##bits##_mont mont;                                                                  \
+        int words = bn_karatsuba_words;                                                        \
+        bn##bits##_from_bignum(&a, x);                                                         \
+        bn##bits##_from_bignum(&b, y);                                                         \
+        bn##bits##_from_bignum(&m, ones);                                                      \
+        bn##bits##_barrett_init(&ctx, &m);                                                     \
+        bn##bits##_mont_init(&mont, &m);                                                       \
+        unsigned long mul = BN_BENCH_TIME(bn##bits##_mul(&a, &b, &prod));                      \
+        unsigned long sqr = BN_BENCH_TIME(bn##bits##_sqr(&a, &prod));                          \
+        unsigned long mod = BN_BENCH_TIME(bn##bits##_mod(&prod, &m, &c));                      \
+        unsigned long mul_mod = BN_BENCH_TIME(bn##bits##_mul_mod(&a, &b, &c, &ctx));           \
+        unsigned long mont_mul = BN_BENCH_TIME(bn##bits##_mont_mul(&a, &b, &c, &mont));        \
+        bn_karatsuba_words = 0;                                                                \
+        unsigned long kmul = BN_BENCH_TIME(bn##bits##_mul(&a, &b, &prod));                     \
+        unsigned long ksqr = BN_BENCH_TIME(bn##bits##_sqr(&a, &prod));                         \
+        bn_karatsuba_words = words;                                                            \
+        cprintf("%5d %10lu %10lu %10lu %10lu %10lu %10lu %10lu\n",                             \
+                bits, mul, sqr, kmul, ksqr, mod, mul_mod, mont_mul);                           \
+    }
+
+BN_BENCH_WIDTH(192)
+BN_BENCH_WIDTH(224)
+BN_BENCH_WIDTH(256)
+BN_BENCH_WIDTH(384)
+BN_BENCH_WIDTH(521)
+BN_BENCH_WIDTH(1024)
+
+int
+mon_bn_bench(int argc, char **argv, struct Trapframe *tf) {
+    bignum x, y, ones, low;
+
+    for (int i = 0; i < BN_ARRAY_SIZE; i++) {
+        x.array[i] = 0x9e3779b9 * (i + 1);
+        y.array[i] = 0x7f4a7c15 ^ (0x01000193 * i);
+        ones.array[i] = ~(DTYPE)0;
+    }
+    x.array[BN_ARRAY_SIZE - 1] >>= 1;
+    y.array[BN_ARRAY_SIZE - 1] >>= 1;
+
+    cprintf("%5s %10s %10s %10s %10s %10s %10s %10s %s\n",
+            "bits", "mul", "sqr", "kmul", "ksqr", "mod", "mul_mod", "mont_mul", "(cycles)");
+    bn_bench_192(&x, &y, &ones);
+    bn_bench_224(&x, &y, &ones);
+    bn_bench_256(&x, &y, &ones);
+    bn_bench_384(&x, &y, &ones);
+    bn_bench_521(&x, &y, &ones);
+    bn_bench_1024(&x, &y, &ones);
+    cprintf("bignum_mul, low 1024 bits: %lu cycles\n", BN_BENCH_TIME(bignum_mul(&x, &y, &low)));
+    return 0;
+}
+
 /* Kernel monitor command interpreter */
 
 static int
@@ -1,20 +1,33 @@
 #include <inc/assert.h>
 #include <inc/x86.h>
+#include <inc/entropy.h>
 #include <kern/env.h>
 #include <kern/monitor.h>
+#include <kern/sched.h>
 
 
 struct Taskstate cpu_ts;
 _Noreturn void sched_halt(void);
 
-extern volatile uint64_t s_entropy[32];
-extern volatile size_t s_entropy_begin, s_entropy_end;
+extern struct entropy_ring sched_entropy;
 
 uint64_t prev_time = 0;
 int measured_tsc = 0;
 
 extern uint64_t InternalRdtsc();
 
+/* Push the TSC delta since the previous sample into the entropy ring,
+ * crediting it with {bits} bits of entropy */
+void
+sched_entropy_sample(uint32_t bits) {
+    uint64_t cur_tsc = InternalRdtsc();
+    if (measured_tsc == 1) {
+        entropy_ring_push(&sched_entropy, cur_tsc - prev_time, bits);
+    }
+    prev_time = cur_tsc;
+    measured_tsc = 1;
+}
+
 /* Choose a user environment to run and run it */
 _Noreturn void
 sched_yield(void) {
@@ -37,20 +50,8 @@ sched_yield(void) {
     int begin = curenv ? ENVX(curenv->env_id) : 0;
     int index = begin;
     bool found = false;
-    if (s_entropy_begin > 0 || s_entropy_end < 32) {
-        uint64_t cur_tsc = InternalRdtsc();
-        if (measured_tsc == 1) {
-            if (s_entropy_begin > 0) {
-                s_entropy[s_entropy_begin - 1] = cur_tsc - prev_time;
-                s_entropy_begin--;
-            } else {
-                s_entropy[s_entropy_end++] = cur_tsc - prev_time;
-            }
-        }
-        prev_time = cur_tsc;
-        measured_tsc = 1;
-    }
-    
+    sched_entropy_sample(SCHED_ENTROPY_BITS);
+
     for (int i = 0; i < NENV; i++) {
         index = (begin + i) % NENV;
         if (envs[index].env_status == ENV_RUNNABLE) {
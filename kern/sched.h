@@ -6,6 +6,12 @@
 #error "This is a JOS kernel header; user programs should not #include it"
 #endif
 
+#include <inc/types.h>
+
+/* Entropy credited to one scheduler timing sample (its low nibble) */
+#define SCHED_ENTROPY_BITS 4
+
 _Noreturn void sched_yield(void);
+void sched_entropy_sample(uint32_t bits);
 
 #endif /* !JOS_KERN_SCHED_H */
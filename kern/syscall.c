@@ -6,6 +6,7 @@
 #include <inc/assert.h>
 
 #include <kern/console.h>
+#include <kern/entropy.h>
 #include <kern/env.h>
 #include <kern/kclock.h>
 #include <kern/pmap.h>
@@ -100,6 +101,7 @@ sys_exofork(void) {
     if (res < 0) { return res; }
     result->env_status = ENV_NOT_RUNNABLE;
     result->env_tf = curenv->env_tf;
+    memcpy(result->env_fpu, curenv->env_fpu, sizeof(result->env_fpu));
     result->env_pgfault_upcall = curenv->env_pgfault_upcall;
     result->env_tf.tf_regs.reg_rax = 0;
     return result->env_id;
@@ -348,6 +350,19 @@ sys_ipc_recv(uintptr_t dstva, uintptr_t maxsize) {
     return 0;
 }
 
+/* Fill [buf, buf+len) with random bytes from the kernel entropy pool.
+ * Requests larger than GETRANDOM_MAX are truncated.
+ * Destroys the environment on memory errors.
+ *
+ * Returns the number of bytes written. */
+static int
+sys_getrandom(void *buf, size_t len) {
+    if (len > GETRANDOM_MAX) len = GETRANDOM_MAX;
+    user_mem_assert(curenv, buf, len, PROT_W | PROT_USER_);
+    entropy_pool_fill(buf, len);
+    return len;
+}
+
 /*
  * This function return the difference between maximal
  * number of references of regions [addr, addr + size] and [addr2,addr2+size2]
@@ -398,6 +413,8 @@ syscall(uintptr_t syscallno, uintptr_t a1, uintptr_t a2, uintptr_t a3, uintptr_t
         return sys_ipc_try_send((envid_t)a1, (uint32_t)a2, a3,(size_t)a4,(int)a5);
     } else if (syscallno == SYS_ipc_recv) {
         return sys_ipc_recv(a1, a2);
+    } else if (syscallno == SYS_getrandom) {
+        return sys_getrandom((void *)a1, (size_t)a2);
     }
     //Your code here end
     return -E_NO_SYS;
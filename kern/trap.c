@@ -381,6 +381,9 @@ trap(struct Trapframe *tf) {
     curenv->env_tf = *tf;
     /* The trapframe on the stack should be ignored from here on */
     tf = &curenv->env_tf;
+    /* The kernel does no floating point here, the registers are still
+     * the environment's */
+    env_save_fpu(curenv);
 
     /* Record that tf is the last real trapframe so
      * print_trapframe can print some additional information */
@@ -23,12 +23,19 @@ There may well be room for performance-optimizations and improvements.
 #include <inc/string.h>
 
 
+#define BN_WORD_BITS (8 * WORD_SIZE)
+#define BN_TMP_BITS  (8 * (int)sizeof(DTYPE_TMP))
+#define BN_INLINE    static inline __attribute__((always_inline))
+
 /* Functions for shifting number in-place. */
-static void _lshift_one_bit(struct bn* a);
 static void _rshift_one_bit(struct bn* a);
 static void _lshift_word(struct bn* a, int nwords);
 static void _rshift_word(struct bn* a, int nwords);
 
+/* Word-level product and division, defined with the fixed-width helpers. */
+static void _mul_low(const struct bn* a, const struct bn* b, struct bn* c);
+static void _bnw_div(const DTYPE* u, int ulen, const DTYPE* v, int vlen, DTYPE* q, DTYPE* r);
+
 
 
 /* Public / Exported functions. */
@@ -96,15 +103,7 @@ void bignum_copy(struct bn* n, const struct bn* m)
 
 void bn_mod(struct bn* r, const struct bn* a, const struct bn* b)
 {
-    struct bn ta,  tb;
-    bignum_copy(&ta, a);
-    bignum_copy(&tb, b);
-    while (bignum_cmp(&ta, &tb) >= 0)
-    {
-        struct bn temp;
-        bignum_sub(&temp, &ta, &tb);
-        bignum_copy(&ta, &temp);
-    }
+    _bnw_div(a->array, BN_ARRAY_SIZE, b->array, BN_ARRAY_SIZE, NULL, r->array);
 }
 
 void bignum_dec(struct bn* n)
@@ -185,75 +184,17 @@ void bignum_sub(struct bn* a, struct bn* b, struct bn* c)
 
 void bignum_mul(struct bn* a, struct bn* b, struct bn* c)
 {
-
-
-    struct bn row;
     struct bn tmp;
-    int i, j;
-
-    bignum_init(c);
 
-    for (i = 0; i < BN_ARRAY_SIZE; ++i)
-    {
-        bignum_init(&row);
-
-        for (j = 0; j < BN_ARRAY_SIZE; ++j)
-        {
-            if (i + j < BN_ARRAY_SIZE)
-            {
-                bignum_init(&tmp);
-                DTYPE_TMP intermediate = ((DTYPE_TMP)a->array[i] * (DTYPE_TMP)b->array[j]);
-                bignum_from_int(&tmp, intermediate);
-                _lshift_word(&tmp, i + j);
-                bignum_add(&tmp, &row, &row);
-            }
-        }
-        bignum_add(c, &row, c);
-    }
+    /* The product is truncated to BN_ARRAY_SIZE words */
+    _mul_low(a, b, &tmp);
+    bignum_assign(c, &tmp);
 }
 
 
 void bignum_div(struct bn* a, struct bn* b, struct bn* c)
 {
-
-
-    struct bn current;
-    struct bn denom;
-    struct bn tmp;
-
-    bignum_from_int(&current, 1);               // int current = 1;
-    bignum_assign(&denom, b);                   // denom = b
-    bignum_assign(&tmp, a);                     // tmp   = a
-
-    const DTYPE_TMP half_max = 1 + (DTYPE_TMP)(MAX_VAL / 2);
-    bool overflow = false;
-    while (bignum_cmp(&denom, a) != LARGER)     // while (denom <= a) {
-    {
-        if (denom.array[BN_ARRAY_SIZE - 1] >= half_max)
-        {
-            overflow = true;
-            break;
-        }
-        _lshift_one_bit(&current);                //   current <<= 1;
-        _lshift_one_bit(&denom);                  //   denom <<= 1;
-    }
-    if (!overflow)
-    {
-        _rshift_one_bit(&denom);                  // denom >>= 1;
-        _rshift_one_bit(&current);                // current >>= 1;
-    }
-    bignum_init(c);                             // int answer = 0;
-
-    while (!bignum_is_zero(&current))           // while (current != 0)
-    {
-        if (bignum_cmp(&tmp, &denom) != SMALLER)  //   if (dividend >= denom)
-        {
-            bignum_sub(&tmp, &denom, &tmp);         //     dividend -= denom;
-            bignum_or(c, &current, c);              //     answer |= current;
-        }
-        _rshift_one_bit(&current);                //   current >>= 1;
-        _rshift_one_bit(&denom);                  //   denom >>= 1;
-    }                                           // return answer;
+    _bnw_div(a->array, BN_ARRAY_SIZE, b->array, BN_ARRAY_SIZE, c->array, NULL);
 }
 
 
@@ -312,14 +253,7 @@ void bignum_rshift(struct bn* a, struct bn* b, int nbits)
 
 void bignum_mod(struct bn* a, struct bn* b, struct bn* c)
 {
-    /*
-      Take divmod and throw away div part
-    */
-
-
-    struct bn tmp;
-
-    bignum_divmod(a,b,&tmp,c);
+    _bnw_div(a->array, BN_ARRAY_SIZE, b->array, BN_ARRAY_SIZE, NULL, c->array);
 }
 
 void bignum_divmod(struct bn* a, struct bn* b, struct bn* c, struct bn* d)
@@ -327,23 +261,8 @@ void bignum_divmod(struct bn* a, struct bn* b, struct bn* c, struct bn* d)
     /*
       Puts a%b in d
       and a/b in c
-
-      mod(a,b) = a - ((a / b) * b)
-
-      example:
-        mod(8, 3) = 8 - ((8 / 3) * 3) = 2
     */
-
-    struct bn tmp;
-
-    /* c = (a / b) */
-    bignum_div(a, b, c);
-
-    /* tmp = (c * b) */
-    bignum_mul(c, b, &tmp);
-
-    /* c = a - tmp */
-    bignum_sub(a, &tmp, d);
+    _bnw_div(a->array, BN_ARRAY_SIZE, b->array, BN_ARRAY_SIZE, c->array, d->array);
 }
 
 
@@ -421,43 +340,22 @@ int bignum_is_zero(struct bn* n)
 }
 
 
+/* Square and multiply, every product keeps the low BN_ARRAY_SIZE limbs */
 void bignum_pow(struct bn* a, struct bn* b, struct bn* c)
 {
+    struct bn acc, base;
 
-    struct bn tmp;
-
-    bignum_init(c);
-
-    if (bignum_cmp(b, c) == EQUAL)
-    {
-        /* Return 1 when exponent is 0 -- n^0 = 1 */
-        bignum_inc(c);
-    }
-    else
+    bignum_assign(&base, a);
+    bignum_from_int(&acc, 1);
+    for (int i = bignum_bit_length(b) - 1; i >= 0; --i)
     {
-        struct bn bcopy;
-        bignum_assign(&bcopy, b);
-
-        /* Copy a -> tmp */
-        bignum_assign(&tmp, a);
-
-        bignum_dec(&bcopy);
-
-        /* Begin summing products: */
-        while (!bignum_is_zero(&bcopy))
+        bignum_mul(&acc, &acc, &acc);
+        if ((b->array[i / BN_WORD_BITS] >> (i % BN_WORD_BITS)) & 1)
         {
-
-            /* c = tmp * tmp */
-            bignum_mul(&tmp, a, c);
-            /* Decrement b by one */
-            bignum_dec(&bcopy);
-
-            bignum_assign(&tmp, c);
+            bignum_mul(&acc, &base, &acc);
         }
-
-        /* c = tmp */
-        bignum_assign(c, &tmp);
     }
+    bignum_assign(c, &acc);
 }
 
 void bignum_isqrt(struct bn *a, struct bn* b)
@@ -548,18 +446,6 @@ static void _lshift_word(struct bn* a, int nwords)
 }
 
 
-static void _lshift_one_bit(struct bn* a)
-{
-
-    int i;
-    for (i = (BN_ARRAY_SIZE - 1); i > 0; --i)
-    {
-        a->array[i] = (a->array[i] << 1) | (a->array[i - 1] >> ((8 * WORD_SIZE) - 1));
-    }
-    a->array[0] <<= 1;
-}
-
-
 static void _rshift_one_bit(struct bn* a)
 {
 
@@ -699,9 +585,16 @@ void bignum_euc(const bignum* a, bignum* c, bignum* b, bignum* d)
 }
 
 
+static void _bignum_reverse_odd(bignum* x, bignum* b, bignum* m);
+
 // x * b = 1 (mod m);
 void bignum_reverse(bignum* x, bignum* b, bignum* m)
 {
+    if (m->array[0] & 1)
+    {
+        _bignum_reverse_odd(x, b, m);
+        return;
+    }
     bignum trash;
     bignum_euc(b, x, m, &trash);
     if (bignum_cmp(x, m) == LARGER)
@@ -742,8 +635,25 @@ void bignum_mul_mod(bignum* a, bignum* b, bignum* c, bignum* n) {
     bignum_mod(&tmp, n, c);
 }
 
-
-
+int bignum_bit_length(struct bn* n)
+{
+    int i;
+    for (i = BN_ARRAY_SIZE - 1; i >= 0; --i)
+    {
+        if (n->array[i])
+        {
+            int bits = 0;
+            DTYPE w = n->array[i];
+            while (w)
+            {
+                ++bits;
+                w >>= 1;
+            }
+            return i * (8 * WORD_SIZE) + bits;
+        }
+    }
+    return 0;
+}
 
 
 void convert_from_md5_to_bignum(bignum* dst, const char* src){
@@ -758,3 +668,986 @@ void convert_from_md5_to_bignum(bignum* dst, const char* src){
     dst->array[2] = a3;
     dst->array[3] = a4;
 }
+
+
+/* Fixed-width families. The helpers work on {words} limbs and are forced
+   inline, BN_DEFINE_WIDTH() instantiates them with a constant word count
+   so every loop is specialized for its width. */
+
+BN_INLINE void _bnw_zero(DTYPE* n, int words)
+{
+    for (int i = 0; i < words; ++i)
+    {
+        n[i] = 0;
+    }
+}
+
+BN_INLINE void _bnw_copy(DTYPE* n, const DTYPE* m, int words)
+{
+    for (int i = 0; i < words; ++i)
+    {
+        n[i] = m[i];
+    }
+}
+
+BN_INLINE int _bnw_cmp(const DTYPE* a, const DTYPE* b, int words)
+{
+    for (int i = words - 1; i >= 0; --i)
+    {
+        if (a[i] != b[i])
+        {
+            return a[i] > b[i] ? LARGER : SMALLER;
+        }
+    }
+    return EQUAL;
+}
+
+BN_INLINE int _bnw_is_zero(const DTYPE* n, int words)
+{
+    DTYPE acc = 0;
+    for (int i = 0; i < words; ++i)
+    {
+        acc |= n[i];
+    }
+    return acc == 0;
+}
+
+BN_INLINE int _bnw_bit_length(const DTYPE* n, int words)
+{
+    for (int i = words - 1; i >= 0; --i)
+    {
+        if (n[i])
+        {
+            return i * BN_WORD_BITS + BN_WORD_BITS - (__builtin_clz(n[i]) - (32 - BN_WORD_BITS));
+        }
+    }
+    return 0;
+}
+
+BN_INLINE DTYPE _bnw_add(const DTYPE* a, const DTYPE* b, DTYPE* c, int words)
+{
+    DTYPE_TMP carry = 0;
+    for (int i = 0; i < words; ++i)
+    {
+        carry += (DTYPE_TMP)a[i] + b[i];
+        c[i] = (DTYPE)carry;
+        carry >>= BN_WORD_BITS;
+    }
+    return (DTYPE)carry;
+}
+
+BN_INLINE DTYPE _bnw_sub(const DTYPE* a, const DTYPE* b, DTYPE* c, int words)
+{
+    DTYPE_TMP borrow = 0;
+    for (int i = 0; i < words; ++i)
+    {
+        DTYPE_TMP res = (DTYPE_TMP)a[i] - b[i] - borrow;
+        c[i] = (DTYPE)res;
+        borrow = (res >> BN_WORD_BITS) & 1;
+    }
+    return (DTYPE)borrow;
+}
+
+/* Product scanning (Comba): column k of the product is the sum of every
+   a[i] * b[k - i], collected in a DTYPE_TMP with the overflows counted in
+   {over}, then one limb is stored and the rest carries into the next
+   column. Only the first {cols} limbs of c are written, 2 * words for the
+   full product, words for its low half. c must not alias a or b. */
+BN_INLINE void _bnw_comba(const DTYPE* a, const DTYPE* b, DTYPE* c, int words, int cols)
+{
+    DTYPE_TMP acc = 0;
+    DTYPE over = 0;
+    for (int k = 0; k < cols; ++k)
+    {
+        for (int i = k < words ? 0 : k - words + 1; i <= k && i < words; ++i)
+        {
+            DTYPE_TMP p = (DTYPE_TMP)a[i] * b[k - i];
+            acc += p;
+            over += acc < p;
+        }
+        c[k] = (DTYPE)acc;
+        acc = (acc >> BN_WORD_BITS) | ((DTYPE_TMP)over << (BN_TMP_BITS - BN_WORD_BITS));
+        over = 0;
+    }
+}
+
+/* Squaring: a[i] * a[j] and a[j] * a[i] are equal, so each column sums the
+   products with i < j once, doubles them and adds the square a[k/2]^2.
+   Roughly half the multiplications of _bnw_comba(a, a, ...). */
+BN_INLINE void _bnw_comba_sqr(const DTYPE* a, DTYPE* c, int words, int cols)
+{
+    DTYPE_TMP acc = 0;
+    DTYPE over = 0;
+    for (int k = 0; k < cols; ++k)
+    {
+        DTYPE_TMP t = 0;
+        DTYPE tover = 0;
+        for (int i = k < words ? 0 : k - words + 1; i < k - i; ++i)
+        {
+            DTYPE_TMP p = (DTYPE_TMP)a[i] * a[k - i];
+            t += p;
+            tover += t < p;
+        }
+        tover = (tover << 1) | (DTYPE)(t >> (BN_TMP_BITS - 1));
+        t <<= 1;
+        if (!(k & 1))
+        {
+            DTYPE_TMP p = (DTYPE_TMP)a[k / 2] * a[k / 2];
+            t += p;
+            tover += t < p;
+        }
+        acc += t;
+        over += tover + (acc < t);
+        c[k] = (DTYPE)acc;
+        acc = (acc >> BN_WORD_BITS) | ((DTYPE_TMP)over << (BN_TMP_BITS - BN_WORD_BITS));
+        over = 0;
+    }
+}
+
+/* Full products from bn_karatsuba_words limbs up go through Karatsuba.
+   With 32-bit limbs the bn_bench monitor command has Comba ahead at every
+   width up to 1024 bits, the additions around the three half size products
+   cost more than the quarter of the multiplications they save. The widest
+   product is the BN_ARRAY_SIZE + 1 limbs of a 1024-bit Barrett quotient
+   estimate, so by default nothing splits. */
+int bn_karatsuba_words = BN_ARRAY_SIZE + 2;
+
+/* Limbs of a half operand plus its carry limb, for operands of up to BN_ARRAY_SIZE + 2 limbs */
+#define BN_KARATSUBA_MAX   (BN_ARRAY_SIZE / 2 + 2)
+
+/* x[0 .. xwords) += y[0 .. ywords), ywords <= xwords, the carry out is dropped */
+static void _bnw_add_in(DTYPE* x, int xwords, const DTYPE* y, int ywords)
+{
+    DTYPE_TMP carry = 0;
+    for (int i = 0; i < xwords && (i < ywords || carry); ++i)
+    {
+        carry += (DTYPE_TMP)x[i] + (i < ywords ? y[i] : 0);
+        x[i] = (DTYPE)carry;
+        carry >>= BN_WORD_BITS;
+    }
+}
+
+/* x[0 .. xwords) -= y[0 .. ywords), ywords <= xwords, x >= y */
+static void _bnw_sub_in(DTYPE* x, int xwords, const DTYPE* y, int ywords)
+{
+    DTYPE_TMP borrow = 0;
+    for (int i = 0; i < xwords && (i < ywords || borrow); ++i)
+    {
+        DTYPE_TMP res = (DTYPE_TMP)x[i] - (i < ywords ? y[i] : 0) - borrow;
+        x[i] = (DTYPE)res;
+        borrow = (res >> BN_WORD_BITS) & 1;
+    }
+}
+
+/* c[0 .. 2 words) = a * b, a == b squares. With a = a1 B + a0, the low
+   half a0 of h limbs and the high a1 of n = words - h:
+   a * b = a1 b1 B^2 + ((a0 + a1)(b0 + b1) - a0 b0 - a1 b1) B + a0 b0. */
+static void _bnw_karatsuba(const DTYPE* a, const DTYPE* b, DTYPE* c, int words)
+{
+    DTYPE sa[BN_KARATSUBA_MAX], sb[BN_KARATSUBA_MAX], mid[2 * BN_KARATSUBA_MAX];
+    int h = words / 2;
+    int n = words - h;
+    int square = a == b;
+
+    /* Below 4 limbs the middle product would not be smaller than a * b */
+    if (words < bn_karatsuba_words || words < 4)
+    {
+        if (square)
+        {
+            _bnw_comba_sqr(a, c, words, 2 * words);
+        }
+        else
+        {
+            _bnw_comba(a, b, c, words, 2 * words);
+        }
+        return;
+    }
+
+    _bnw_karatsuba(a, b, c, h);                     /* a0 b0 */
+    _bnw_karatsuba(a + h, b + h, c + 2 * h, n);     /* a1 b1 */
+
+    _bnw_copy(sa, a + h, n);
+    sa[n] = 0;
+    _bnw_add_in(sa, n + 1, a, h);
+    if (!square)
+    {
+        _bnw_copy(sb, b + h, n);
+        sb[n] = 0;
+        _bnw_add_in(sb, n + 1, b, h);
+    }
+    _bnw_karatsuba(sa, square ? sa : sb, mid, n + 1);
+    _bnw_sub_in(mid, 2 * n + 2, c, 2 * h);
+    _bnw_sub_in(mid, 2 * n + 2, c + 2 * h, 2 * n);
+    /* The middle term is below 2^(8 * WORD_SIZE * (2 n + 1)), it fits above h */
+    _bnw_add_in(c + h, 2 * words - h, mid, 2 * n + 1);
+}
+
+/* c[0 .. 2 words) = a * b, c must not alias a or b */
+BN_INLINE void _bnw_mul(const DTYPE* a, const DTYPE* b, DTYPE* c, int words)
+{
+    if (words >= bn_karatsuba_words)
+    {
+        _bnw_karatsuba(a, b, c, words);
+    }
+    else
+    {
+        _bnw_comba(a, b, c, words, 2 * words);
+    }
+}
+
+/* c[0 .. 2 words) = a^2, c must not alias a */
+BN_INLINE void _bnw_sqr(const DTYPE* a, DTYPE* c, int words)
+{
+    if (words >= bn_karatsuba_words)
+    {
+        _bnw_karatsuba(a, a, c, words);
+    }
+    else
+    {
+        _bnw_comba_sqr(a, c, words, 2 * words);
+    }
+}
+
+static void _mul_low(const struct bn* a, const struct bn* b, struct bn* c)
+{
+    if (a == b)
+    {
+        _bnw_comba_sqr(a->array, c->array, BN_ARRAY_SIZE, BN_ARRAY_SIZE);
+    }
+    else
+    {
+        _bnw_comba(a->array, b->array, c->array, BN_ARRAY_SIZE, BN_ARRAY_SIZE);
+    }
+}
+
+/* n <<= 1, returns the bit shifted out */
+BN_INLINE DTYPE _bnw_shl1(DTYPE* n, int words)
+{
+    DTYPE out = n[words - 1] >> (BN_WORD_BITS - 1);
+    for (int i = words - 1; i > 0; --i)
+    {
+        n[i] = (n[i] << 1) | (n[i - 1] >> (BN_WORD_BITS - 1));
+    }
+    n[0] <<= 1;
+    return out;
+}
+
+BN_INLINE void _bnw_shr1(DTYPE* n, int words)
+{
+    for (int i = 0; i < words - 1; ++i)
+    {
+        n[i] = (n[i] >> 1) | (n[i + 1] << (BN_WORD_BITS - 1));
+    }
+    n[words - 1] >>= 1;
+}
+
+/* Widest dividend: the 2 k + 1 limbs of 2^(2 * 8 * WORD_SIZE * k) for a Barrett mu */
+#define BN_DIV_MAX (2 * BN_ARRAY_SIZE + 1)
+
+/* x << s limb by limb, {low} is the limb below x, 0 <= s < 8 * WORD_SIZE */
+#define BN_SHL_LIMB(x, low, s) ((DTYPE)((x) << (s)) | (DTYPE)((DTYPE_TMP)(low) >> (BN_WORD_BITS - (s))))
+
+/* Knuth's Algorithm D (TAOCP 4.3.1). q[0 .. ulen) = u / v, r[0 .. vlen) = u % v,
+   either may be NULL or alias u or v, v != 0 and ulen <= BN_DIV_MAX. Both
+   operands are shifted so the top limb of v has its high bit set, then
+   every quotient limb is estimated from the top two limbs of the running
+   remainder and is at most one too large after the check against the
+   next limb of v. */
+static void _bnw_div(const DTYPE* u, int ulen, const DTYPE* v, int vlen, DTYPE* q, DTYPE* r)
+{
+    DTYPE un[BN_DIV_MAX + 1], vn[BN_DIV_MAX], qn[BN_DIV_MAX];
+    int qlen = ulen;
+    int rlen = vlen;
+
+    while (ulen > 0 && !u[ulen - 1])
+    {
+        --ulen;
+    }
+    while (vlen > 0 && !v[vlen - 1])
+    {
+        --vlen;
+    }
+    _bnw_zero(qn, BN_DIV_MAX);
+    if (vlen == 0 || ulen < vlen)
+    {
+        /* Quotient 0, the remainder is u (or 0 for a zero divisor) */
+        _bnw_copy(un, u, ulen);
+        _bnw_zero(un + ulen, rlen > ulen ? rlen - ulen : 0);
+        if (vlen == 0)
+        {
+            _bnw_zero(un, rlen);
+        }
+        if (q)
+        {
+            _bnw_copy(q, qn, qlen);
+        }
+        if (r)
+        {
+            _bnw_copy(r, un, rlen);
+        }
+        return;
+    }
+
+    int s = __builtin_clz(v[vlen - 1]) - (32 - BN_WORD_BITS);
+    for (int i = vlen - 1; i > 0; --i)
+    {
+        vn[i] = BN_SHL_LIMB(v[i], v[i - 1], s);
+    }
+    vn[0] = (DTYPE)(v[0] << s);
+    un[ulen] = (DTYPE)((DTYPE_TMP)u[ulen - 1] >> (BN_WORD_BITS - s));
+    for (int i = ulen - 1; i > 0; --i)
+    {
+        un[i] = BN_SHL_LIMB(u[i], u[i - 1], s);
+    }
+    un[0] = (DTYPE)(u[0] << s);
+
+    for (int j = ulen - vlen; j >= 0; --j)
+    {
+        DTYPE_TMP num = ((DTYPE_TMP)un[j + vlen] << BN_WORD_BITS) | un[j + vlen - 1];
+        DTYPE_TMP qhat = num / vn[vlen - 1];
+        DTYPE_TMP rhat = num - qhat * vn[vlen - 1];
+        while (qhat > MAX_VAL ||
+               (vlen > 1 && qhat * vn[vlen - 2] > ((rhat << BN_WORD_BITS) | un[j + vlen - 2])))
+        {
+            --qhat;
+            rhat += vn[vlen - 1];
+            if (rhat > MAX_VAL)
+            {
+                break;
+            }
+        }
+
+        /* un[j .. j + vlen] -= qhat * vn */
+        DTYPE_TMP carry = 0, borrow = 0;
+        for (int i = 0; i < vlen; ++i)
+        {
+            DTYPE_TMP p = qhat * vn[i] + carry;
+            carry = p >> BN_WORD_BITS;
+            DTYPE_TMP t = (DTYPE_TMP)un[i + j] - (DTYPE)p - borrow;
+            un[i + j] = (DTYPE)t;
+            borrow = (t >> BN_WORD_BITS) & 1;
+        }
+        DTYPE_TMP t = (DTYPE_TMP)un[j + vlen] - carry - borrow;
+        un[j + vlen] = (DTYPE)t;
+
+        /* Rarely the estimate was one too large: add vn back */
+        if ((t >> BN_WORD_BITS) & 1)
+        {
+            --qhat;
+            carry = 0;
+            for (int i = 0; i < vlen; ++i)
+            {
+                carry += (DTYPE_TMP)un[i + j] + vn[i];
+                un[i + j] = (DTYPE)carry;
+                carry >>= BN_WORD_BITS;
+            }
+            un[j + vlen] += (DTYPE)carry;
+        }
+        qn[j] = (DTYPE)qhat;
+    }
+
+    if (q)
+    {
+        _bnw_copy(q, qn, qlen);
+    }
+    if (r)
+    {
+        for (int i = 0; i < vlen; ++i)
+        {
+            r[i] = (DTYPE)(un[i] >> s) | (DTYPE)(((DTYPE_TMP)un[i + 1] << BN_WORD_BITS) >> s);
+        }
+        _bnw_zero(r + vlen, rlen - vlen);
+    }
+}
+
+/* c = a mod m, a has {awords} limbs, m {words} */
+BN_INLINE void _bnw_mod(const DTYPE* a, int awords, const DTYPE* m, DTYPE* c, int words)
+{
+    _bnw_div(a, awords, m, words, NULL, c);
+}
+
+/* Barrett reduction (HAC 14.42) for a modulus m of exactly {words} limbs,
+   with B = 2^(8 * WORD_SIZE) and mu = floor(B^(2 words) / m) of words + 1
+   limbs. For a < B^(2 words) the quotient estimate
+   floor(floor(a / B^(words - 1)) * mu / B^(words + 1)) is at most two
+   short, the remainder is taken modulo B^(words + 1) and corrected by at
+   most two subtractions. {tmp} holds 4 (words + 1) limbs. */
+BN_INLINE void _bnw_barrett(const DTYPE* a, const DTYPE* m, const DTYPE* mu, DTYPE* c, int words, DTYPE* tmp)
+{
+    DTYPE* q = tmp;                       /* 2 (words + 1) */
+    DTYPE* mq = q + 2 * (words + 1);
+    DTYPE* mp = mq + words + 1;
+
+    /* q = a / B^(words - 1) * mu, its top words + 1 limbs are the estimate */
+    _bnw_mul(a + words - 1, mu, q, words + 1);
+    /* mq = q3 * m mod B^(words + 1) */
+    _bnw_copy(mp, m, words);
+    mp[words] = 0;
+    _bnw_comba(q + words + 1, mp, mq, words + 1, words + 1);
+    /* the remainder fits in words + 1 limbs, the borrow out is the wrap */
+    _bnw_sub(a, mq, mq, words + 1);
+    while (mq[words] || _bnw_cmp(mq, m, words) != SMALLER)
+    {
+        _bnw_sub(mq, mp, mq, words + 1);
+    }
+    _bnw_copy(c, mq, words);
+}
+
+/* c = a / b, d = a % b, b != 0 */
+BN_INLINE void _bnw_divmod(const DTYPE* a, const DTYPE* b, DTYPE* c, DTYPE* d, int words)
+{
+    _bnw_div(a, words, b, words, c, d);
+}
+
+/* -m0^-1 mod B for an odd m0. Newton iteration: every step doubles the
+   number of correct low bits, an odd m0 is its own inverse modulo 8. */
+BN_INLINE DTYPE _bnw_mont_minv(DTYPE m0)
+{
+    DTYPE inv = m0;
+    for (int bits = 3; bits < BN_WORD_BITS; bits *= 2)
+    {
+        inv = (DTYPE)(inv * (DTYPE)(2 - m0 * inv));
+    }
+    return (DTYPE)(0 - inv);
+}
+
+/* Montgomery reduction with R = B^words: c = t / R mod m for an odd m and
+   t < m R. t has 2 words + 1 limbs and is consumed, every step adds the
+   multiple of m that clears its lowest limb. t / R < 2 m, the spare top
+   limb holds the one bit that may not fit. */
+BN_INLINE void _bnw_mont_reduce(DTYPE* t, const DTYPE* m, DTYPE minv, DTYPE* c, int words)
+{
+    for (int i = 0; i < words; ++i)
+    {
+        DTYPE u = (DTYPE)(t[i] * minv);
+        DTYPE_TMP carry = 0;
+        for (int j = 0; j < words; ++j)
+        {
+            carry += (DTYPE_TMP)u * m[j] + t[i + j];
+            t[i + j] = (DTYPE)carry;
+            carry >>= BN_WORD_BITS;
+        }
+        for (int k = i + words; carry && k < 2 * words + 1; ++k)
+        {
+            carry += t[k];
+            t[k] = (DTYPE)carry;
+            carry >>= BN_WORD_BITS;
+        }
+    }
+    if (t[2 * words] || _bnw_cmp(t + words, m, words) != SMALLER)
+    {
+        _bnw_sub(t + words, m, c, words);
+    }
+    else
+    {
+        _bnw_copy(c, t + words, words);
+    }
+}
+
+/* c = a b / R mod m, b == a squares. {t} holds 2 words + 1 limbs. */
+BN_INLINE void _bnw_mont_mul(const DTYPE* a, const DTYPE* b, DTYPE* c, const DTYPE* m, DTYPE minv, int words, DTYPE* t)
+{
+    if (a == b)
+    {
+        _bnw_sqr(a, t, words);
+    }
+    else
+    {
+        _bnw_mul(a, b, t, words);
+    }
+    t[2 * words] = 0;
+    _bnw_mont_reduce(t, m, minv, c, words);
+}
+
+/* R^2 mod m, the constant that takes a value into Montgomery form */
+BN_INLINE void _bnw_mont_rr(const DTYPE* m, DTYPE* rr, int words, DTYPE* pow)
+{
+    _bnw_zero(pow, 2 * words);
+    pow[2 * words] = 1;
+    _bnw_div(pow, 2 * words + 1, m, words, NULL, rr);
+}
+
+/* Widest sliding window of the exponentiations, {table} holds the
+   2^(BN_POW_WINDOW - 1) odd powers a, a^3, ... of the base */
+#define BN_POW_WINDOW 5
+#define BN_POW_TABLE  (1 << (BN_POW_WINDOW - 1))
+
+BN_INLINE int _bnw_bit(const DTYPE* n, int i)
+{
+    return (n[i / BN_WORD_BITS] >> (i % BN_WORD_BITS)) & 1;
+}
+
+/* Window width for an exponent of {bits} bits, the break-even points of
+   2^(w - 1) table products against bits / (w + 1) window products */
+BN_INLINE int _bnw_pow_window(int bits)
+{
+    return bits > 239 ? 5 : bits > 79 ? 4 : bits > 23 ? 3 : 1;
+}
+
+/* acc = a^e mod m, all in Montgomery form with {one} = R mod m. Left to
+   right sliding window over the bits of e ({ewords} limbs): every run of
+   up to w bits that starts and ends with a one costs a single product
+   with a^(odd) from {table}, zeros between runs only square. acc must not
+   alias e. {t} holds 2 words + 1 limbs, {table} BN_POW_TABLE * words. */
+BN_INLINE void _bnw_mont_pow(const DTYPE* a, const DTYPE* e, int ewords, DTYPE* acc, const DTYPE* one,
+                             const DTYPE* m, DTYPE minv, int words, DTYPE* t, DTYPE* table)
+{
+    int i = _bnw_bit_length(e, ewords) - 1;
+    int w = _bnw_pow_window(i + 1);
+    int started = 0;
+
+    _bnw_copy(table, a, words);
+    if (w > 1)
+    {
+        _bnw_mont_mul(a, a, acc, m, minv, words, t);
+        for (int k = 1; k < (1 << (w - 1)); ++k)
+        {
+            _bnw_mont_mul(table + (k - 1) * words, acc, table + k * words, m, minv, words, t);
+        }
+    }
+    _bnw_copy(acc, one, words);
+    while (i >= 0)
+    {
+        if (!_bnw_bit(e, i))
+        {
+            if (started)
+            {
+                _bnw_mont_mul(acc, acc, acc, m, minv, words, t);
+            }
+            --i;
+            continue;
+        }
+        int j = i - w + 1 < 0 ? 0 : i - w + 1;
+        while (!_bnw_bit(e, j))
+        {
+            ++j;
+        }
+        int value = 0;
+        for (int k = i; k >= j; --k)
+        {
+            value = (value << 1) | _bnw_bit(e, k);
+            if (started)
+            {
+                _bnw_mont_mul(acc, acc, acc, m, minv, words, t);
+            }
+        }
+        if (started)
+        {
+            _bnw_mont_mul(acc, table + (value >> 1) * words, acc, m, minv, words, t);
+        }
+        else
+        {
+            _bnw_copy(acc, table + (value >> 1) * words, words);
+            started = 1;
+        }
+        i = j - 1;
+    }
+}
+
+/* c = a + b mod m, the carry out of the sum counts as 2^(8 * WORD_SIZE * words) */
+BN_INLINE void _bnw_add_mod(const DTYPE* a, const DTYPE* b, DTYPE* c, const DTYPE* m, int words)
+{
+    DTYPE carry = _bnw_add(a, b, c, words);
+    if (carry || _bnw_cmp(c, m, words) != SMALLER)
+    {
+        _bnw_sub(c, m, c, words);
+    }
+}
+
+BN_INLINE void _bnw_sub_mod(const DTYPE* a, const DTYPE* b, DTYPE* c, const DTYPE* m, int words)
+{
+    if (_bnw_sub(a, b, c, words))
+    {
+        _bnw_add(c, m, c, words);
+    }
+}
+
+/* Extended Euclid on magnitudes. The coefficients of b alternate in sign,
+   so |s_(i+1)| = |s_(i-1)| + q_i |s_i| never wraps and the parity of the
+   step count gives the sign of the result. */
+BN_INLINE void _bnw_reverse(DTYPE* x, const DTYPE* b, const DTYPE* m, int words, DTYPE* tmp)
+{
+    DTYPE* u = tmp;
+    DTYPE* v = u + words;
+    DTYPE* s0 = v + words;
+    DTYPE* s1 = s0 + words;
+    DTYPE* q = s1 + words;
+    DTYPE* r = q + words;
+    DTYPE* prod = r + words; /* 2 * words */
+    int negative = 0;
+
+    _bnw_copy(u, b, words);
+    _bnw_copy(v, m, words);
+    _bnw_zero(s0, words);
+    _bnw_zero(s1, words);
+    s0[0] = 1;
+    while (!_bnw_is_zero(v, words))
+    {
+        _bnw_divmod(u, v, q, r, words);
+        /* s0, s1 = s1, s0 + q * s1 */
+        _bnw_mul(q, s1, prod, words);
+        _bnw_add(s0, prod, prod, words);
+        _bnw_copy(s0, s1, words);
+        _bnw_copy(s1, prod, words);
+        _bnw_copy(u, v, words);
+        _bnw_copy(v, r, words);
+        negative = !negative;
+    }
+    /* s0 belongs to the last nonzero remainder, it is negative after an odd number of steps */
+    if (negative && !_bnw_is_zero(s0, words))
+    {
+        _bnw_sub(m, s0, x, words);
+    }
+    else
+    {
+        _bnw_copy(x, s0, words);
+    }
+}
+
+BN_INLINE int _bnw_is_one(const DTYPE* n, int words)
+{
+    DTYPE acc = n[0] ^ 1;
+    for (int i = 1; i < words; ++i)
+    {
+        acc |= n[i];
+    }
+    return acc == 0;
+}
+
+/* x = x / 2 mod an odd m, x < m */
+BN_INLINE void _bnw_half_mod(DTYPE* x, const DTYPE* m, int words)
+{
+    DTYPE carry = 0;
+    if (x[0] & 1)
+    {
+        carry = _bnw_add(x, m, x, words);
+    }
+    _bnw_shr1(x, words);
+    x[words - 1] |= carry << (BN_WORD_BITS - 1);
+}
+
+/* Binary inversion modulo an odd m (Guide to ECC, Algorithm 2.22): no
+   divisions, only shifts, subtractions and halvings mod m. x1 * b = u and
+   x2 * b = v (mod m) hold throughout, u and v shed their factors of two
+   and the smaller is taken off the larger until one of them is 1. x = 0
+   if b has no inverse. {tmp} holds 4 * words limbs. */
+BN_INLINE void _bnw_reverse_odd(DTYPE* x, const DTYPE* b, const DTYPE* m, int words, DTYPE* tmp)
+{
+    DTYPE* u = tmp;
+    DTYPE* v = u + words;
+    DTYPE* x1 = v + words;
+    DTYPE* x2 = x1 + words;
+
+    _bnw_copy(u, b, words);
+    _bnw_copy(v, m, words);
+    _bnw_zero(x1, words);
+    _bnw_zero(x2, words);
+    x1[0] = 1;
+    if (_bnw_is_zero(u, words))
+    {
+        _bnw_zero(x, words);
+        return;
+    }
+    while (!_bnw_is_one(u, words) && !_bnw_is_one(v, words))
+    {
+        while (!(u[0] & 1))
+        {
+            _bnw_shr1(u, words);
+            _bnw_half_mod(x1, m, words);
+        }
+        while (!(v[0] & 1))
+        {
+            _bnw_shr1(v, words);
+            _bnw_half_mod(x2, m, words);
+        }
+        if (_bnw_cmp(u, v, words) != SMALLER)
+        {
+            _bnw_sub(u, v, u, words);
+            _bnw_sub_mod(x1, x2, x1, m, words);
+        }
+        else
+        {
+            _bnw_sub(v, u, v, words);
+            _bnw_sub_mod(x2, x1, x2, m, words);
+        }
+        /* u = v, both odd: gcd(b, m) = u > 1 */
+        if (_bnw_is_zero(u, words) || _bnw_is_zero(v, words))
+        {
+            _bnw_zero(x, words);
+            return;
+        }
+    }
+    _bnw_copy(x, _bnw_is_one(u, words) ? x1 : x2, words);
+}
+
+#define BN_DEFINE_WIDTH(bits)                                                                    \
+    void bn##bits##_init(bn##bits* n) { _bnw_zero(n->array, BN_WORDS(bits)); }                   \
+    void bn##bits##_from_int(bn##bits* n, DTYPE_TMP i)                                           \
+    {                                                                                            \
+        _bnw_zero(n->array, BN_WORDS(bits));                                                     \
+        n->array[0] = (DTYPE)i;                                                                  \
+        n->array[1] = (DTYPE)(i >> BN_WORD_BITS);                                                \
+    }                                                                                            \
+    void bn##bits##_from_bignum(bn##bits* n, const struct bn* m)                                 \
+    {                                                                                            \
+        _bnw_copy(n->array, m->array, BN_WORDS(bits));                                           \
+        if ((bits) % BN_WORD_BITS)                                                               \
+            n->array[BN_WORDS(bits) - 1] &= ((DTYPE)1 << ((bits) % BN_WORD_BITS)) - 1;           \
+    }                                                                                            \
+    void bn##bits##_to_bignum(struct bn* n, const bn##bits* m)                                   \
+    {                                                                                            \
+        bignum_init(n);                                                                          \
+        _bnw_copy(n->array, m->array, BN_WORDS(bits));                                           \
+    }                                                                                            \
+    void bn##bits##_copy(bn##bits* n, const bn##bits* m) { *n = *m; }                            \
+    int bn##bits##_cmp(const bn##bits* a, const bn##bits* b)                                     \
+    {                                                                                            \
+        return _bnw_cmp(a->array, b->array, BN_WORDS(bits));                                     \
+    }                                                                                            \
+    int bn##bits##_is_zero(const bn##bits* n) { return _bnw_is_zero(n->array, BN_WORDS(bits)); } \
+    int bn##bits##_bit(const bn##bits* n, int i)                                                 \
+    {                                                                                            \
+        return (n->array[i / BN_WORD_BITS] >> (i % BN_WORD_BITS)) & 1;                           \
+    }                                                                                            \
+    int bn##bits##_bit_length(const bn##bits* n)                                                 \
+    {                                                                                            \
+        return _bnw_bit_length(n->array, BN_WORDS(bits));                                        \
+    }                                                                                            \
+    DTYPE bn##bits##_add(const bn##bits* a, const bn##bits* b, bn##bits* c)                      \
+    {                                                                                            \
+        return _bnw_add(a->array, b->array, c->array, BN_WORDS(bits));                           \
+    }                                                                                            \
+    DTYPE bn##bits##_sub(const bn##bits* a, const bn##bits* b, bn##bits* c)                      \
+    {                                                                                            \
+        return _bnw_sub(a->array, b->array, c->array, BN_WORDS(bits));                           \
+    }                                                                                            \
+    void bn##bits##_mul(const bn##bits* a, const bn##bits* b, bn##bits##w* c)                    \
+    {                                                                                            \
+        _bnw_mul(a->array, b->array, c->array, BN_WORDS(bits));                                  \
+    }                                                                                            \
+    void bn##bits##_sqr(const bn##bits* a, bn##bits##w* c)                                       \
+    {                                                                                            \
+        _bnw_sqr(a->array, c->array, BN_WORDS(bits));                                            \
+    }                                                                                            \
+    void bn##bits##_divmod(const bn##bits* a, const bn##bits* b, bn##bits* c, bn##bits* d)       \
+    {                                                                                            \
+        _bnw_divmod(a->array, b->array, c->array, d->array, BN_WORDS(bits));                     \
+    }                                                                                            \
+    void bn##bits##_mod(const bn##bits##w* a, const bn##bits* m, bn##bits* c)                    \
+    {                                                                                            \
+        _bnw_mod(a->array, 2 * BN_WORDS(bits), m->array, c->array, BN_WORDS(bits));              \
+    }                                                                                            \
+    void bn##bits##_widen(const bn##bits* a, bn##bits##w* c)                                     \
+    {                                                                                            \
+        _bnw_copy(c->array, a->array, BN_WORDS(bits));                                           \
+        _bnw_zero(c->array + BN_WORDS(bits), BN_WORDS(bits));                                    \
+    }                                                                                            \
+    void bn##bits##_add_mod(const bn##bits* a, const bn##bits* b, bn##bits* c, const bn##bits* m) \
+    {                                                                                            \
+        _bnw_add_mod(a->array, b->array, c->array, m->array, BN_WORDS(bits));                    \
+    }                                                                                            \
+    void bn##bits##_sub_mod(const bn##bits* a, const bn##bits* b, bn##bits* c, const bn##bits* m) \
+    {                                                                                            \
+        _bnw_sub_mod(a->array, b->array, c->array, m->array, BN_WORDS(bits));                    \
+    }                                                                                            \
+    void bn##bits##_barrett_init(bn##bits##_barrett* ctx, const bn##bits* m)                     \
+    {                                                                                            \
+        DTYPE pow[2 * BN_WORDS(bits) + 1], mu[2 * BN_WORDS(bits) + 1];                           \
+        ctx->m = *m;                                                                             \
+        _bnw_zero(pow, 2 * BN_WORDS(bits));                                                      \
+        pow[2 * BN_WORDS(bits)] = 1;                                                             \
+        _bnw_div(pow, 2 * BN_WORDS(bits) + 1, m->array, BN_WORDS(bits), mu, NULL);               \
+        _bnw_copy(ctx->mu, mu, BN_WORDS(bits) + 1);                                              \
+        ctx->barrett = m->array[BN_WORDS(bits) - 1] && !mu[BN_WORDS(bits) + 1];                  \
+    }                                                                                            \
+    void bn##bits##_barrett_reduce(const bn##bits##w* a, const bn##bits##_barrett* ctx, bn##bits* c) \
+    {                                                                                            \
+        DTYPE tmp[4 * (BN_WORDS(bits) + 1)];                                                     \
+        if (ctx->barrett)                                                                        \
+            _bnw_barrett(a->array, ctx->m.array, ctx->mu, c->array, BN_WORDS(bits), tmp);        \
+        else                                                                                     \
+            _bnw_mod(a->array, 2 * BN_WORDS(bits), ctx->m.array, c->array, BN_WORDS(bits));      \
+    }                                                                                            \
+    void bn##bits##_mul_mod(const bn##bits* a, const bn##bits* b, bn##bits* c, const bn##bits##_barrett* m) \
+    {                                                                                            \
+        bn##bits##w prod;                                                                        \
+        _bnw_mul(a->array, b->array, prod.array, BN_WORDS(bits));                                \
+        bn##bits##_barrett_reduce(&prod, m, c);                                                  \
+    }                                                                                            \
+    void bn##bits##_sqr_mod(const bn##bits* a, bn##bits* c, const bn##bits##_barrett* m)         \
+    {                                                                                            \
+        bn##bits##w prod;                                                                        \
+        _bnw_sqr(a->array, prod.array, BN_WORDS(bits));                                          \
+        bn##bits##_barrett_reduce(&prod, m, c);                                                  \
+    }                                                                                            \
+    void bn##bits##_mont_init(bn##bits##_mont* ctx, const bn##bits* m)                           \
+    {                                                                                            \
+        DTYPE pow[2 * BN_WORDS(bits) + 1];                                                       \
+        ctx->m = *m;                                                                             \
+        ctx->minv = _bnw_mont_minv(m->array[0]);                                                 \
+        _bnw_mont_rr(m->array, ctx->rr.array, BN_WORDS(bits), pow);                              \
+    }                                                                                            \
+    void bn##bits##_mont_mul(const bn##bits* a, const bn##bits* b, bn##bits* c, const bn##bits##_mont* ctx) \
+    {                                                                                            \
+        DTYPE t[2 * BN_WORDS(bits) + 1];                                                         \
+        _bnw_mont_mul(a->array, b->array, c->array, ctx->m.array, ctx->minv, BN_WORDS(bits), t); \
+    }                                                                                            \
+    void bn##bits##_mont_sqr(const bn##bits* a, bn##bits* c, const bn##bits##_mont* ctx)         \
+    {                                                                                            \
+        DTYPE t[2 * BN_WORDS(bits) + 1];                                                         \
+        _bnw_mont_mul(a->array, a->array, c->array, ctx->m.array, ctx->minv, BN_WORDS(bits), t); \
+    }                                                                                            \
+    void bn##bits##_to_mont(const bn##bits* a, bn##bits* c, const bn##bits##_mont* ctx)          \
+    {                                                                                            \
+        DTYPE t[2 * BN_WORDS(bits) + 1];                                                         \
+        _bnw_mont_mul(a->array, ctx->rr.array, c->array, ctx->m.array, ctx->minv, BN_WORDS(bits), t); \
+    }                                                                                            \
+    void bn##bits##_from_mont(const bn##bits* a, bn##bits* c, const bn##bits##_mont* ctx)        \
+    {                                                                                            \
+        DTYPE t[2 * BN_WORDS(bits) + 1];                                                         \
+        _bnw_copy(t, a->array, BN_WORDS(bits));                                                  \
+        _bnw_zero(t + BN_WORDS(bits), BN_WORDS(bits) + 1);                                       \
+        _bnw_mont_reduce(t, ctx->m.array, ctx->minv, c->array, BN_WORDS(bits));                  \
+    }                                                                                            \
+    void bn##bits##_mont_pow(const bn##bits* a, const bn##bits* e, bn##bits* c, const bn##bits##_mont* ctx) \
+    {                                                                                            \
+        DTYPE t[2 * BN_WORDS(bits) + 1], table[BN_POW_TABLE * BN_WORDS(bits)];                   \
+        bn##bits base, one, acc;                                                                 \
+        bn##bits##_to_mont(a, &base, ctx);                                                       \
+        bn##bits##_from_int(&one, 1);                                                            \
+        bn##bits##_to_mont(&one, &one, ctx);                                                     \
+        _bnw_mont_pow(base.array, e->array, BN_WORDS(bits), acc.array, one.array,                \
+                      ctx->m.array, ctx->minv, BN_WORDS(bits), t, table);                        \
+        bn##bits##_from_mont(&acc, c, ctx);                                                      \
+    }                                                                                            \
+    void bn##bits##_mont_reverse(const bn##bits* a, bn##bits* c, const bn##bits##_mont* ctx)     \
+    {                                                                                            \
+        DTYPE t[2 * BN_WORDS(bits) + 1], table[BN_POW_TABLE * BN_WORDS(bits)];                   \
+        bn##bits e, one, acc;                                                                    \
+        bn##bits##_from_int(&e, 2);                                                              \
+        _bnw_sub(ctx->m.array, e.array, e.array, BN_WORDS(bits));                                \
+        bn##bits##_from_int(&one, 1);                                                            \
+        bn##bits##_to_mont(&one, &one, ctx);                                                     \
+        _bnw_mont_pow(a->array, e.array, BN_WORDS(bits), acc.array, one.array,                   \
+                      ctx->m.array, ctx->minv, BN_WORDS(bits), t, table);                        \
+        *c = acc;                                                                                \
+    }                                                                                            \
+    void bn##bits##_negate(bn##bits* x, const bn##bits* m)                                       \
+    {                                                                                            \
+        if (!_bnw_is_zero(x->array, BN_WORDS(bits)))                                             \
+            _bnw_sub(m->array, x->array, x->array, BN_WORDS(bits));                              \
+    }                                                                                            \
+    void bn##bits##_reverse(bn##bits* x, const bn##bits* b, const bn##bits* m)                   \
+    {                                                                                            \
+        DTYPE tmp[8 * BN_WORDS(bits)];                                                           \
+        if (m->array[0] & 1)                                                                     \
+            _bnw_reverse_odd(x->array, b->array, m->array, BN_WORDS(bits), tmp);                 \
+        else                                                                                     \
+            _bnw_reverse(x->array, b->array, m->array, BN_WORDS(bits), tmp);                     \
+    }
+
+BN_DEFINE_WIDTH(192)
+BN_DEFINE_WIDTH(224)
+BN_DEFINE_WIDTH(256)
+BN_DEFINE_WIDTH(384)
+BN_DEFINE_WIDTH(521)
+BN_DEFINE_WIDTH(1024)
+
+
+/* Montgomery arithmetic on struct bn, R = 2^(8 * WORD_SIZE * BN_ARRAY_SIZE).
+   The modulus may use the full width of the array, so intermediate
+   results live in a double width word array with one spare word. */
+#define BN_MONT_WORDS (2 * BN_ARRAY_SIZE + 1)
+
+DTYPE bignum_mont_minv(struct bn* m)
+{
+    return _bnw_mont_minv(m->array[0]);
+}
+
+void bignum_mont_init(bn_mont_ctx* ctx, struct bn* m)
+{
+    DTYPE pow[BN_MONT_WORDS];
+    bignum_copy(&ctx->m, m);
+    ctx->minv = _bnw_mont_minv(m->array[0]);
+    _bnw_mont_rr(m->array, ctx->rr.array, BN_ARRAY_SIZE, pow);
+}
+
+void bignum_mont_mul(struct bn* a, struct bn* b, struct bn* c, const bn_mont_ctx* ctx)
+{
+    DTYPE t[BN_MONT_WORDS];
+    _bnw_mont_mul(a->array, b->array, c->array, ctx->m.array, ctx->minv, BN_ARRAY_SIZE, t);
+}
+
+void bignum_mont_sqr(struct bn* a, struct bn* c, const bn_mont_ctx* ctx)
+{
+    DTYPE t[BN_MONT_WORDS];
+    _bnw_mont_mul(a->array, a->array, c->array, ctx->m.array, ctx->minv, BN_ARRAY_SIZE, t);
+}
+
+void bignum_to_mont(struct bn* a, struct bn* c, const bn_mont_ctx* ctx)
+{
+    DTYPE t[BN_MONT_WORDS];
+    _bnw_mont_mul(a->array, ctx->rr.array, c->array, ctx->m.array, ctx->minv, BN_ARRAY_SIZE, t);
+}
+
+void bignum_from_mont(struct bn* a, struct bn* c, const bn_mont_ctx* ctx)
+{
+    DTYPE t[BN_MONT_WORDS] = {0};
+    _bnw_copy(t, a->array, BN_ARRAY_SIZE);
+    _bnw_mont_reduce(t, ctx->m.array, ctx->minv, c->array, BN_ARRAY_SIZE);
+}
+
+static void _bignum_reverse_odd(bignum* x, bignum* b, bignum* m)
+{
+    DTYPE tmp[4 * BN_ARRAY_SIZE];
+    _bnw_reverse_odd(x->array, b->array, m->array, BN_ARRAY_SIZE, tmp);
+}
+
+void bignum_mont_pow(struct bn* a, struct bn* e, struct bn* c, const bn_mont_ctx* ctx)
+{
+    DTYPE t[BN_MONT_WORDS], table[BN_POW_TABLE * BN_ARRAY_SIZE];
+    struct bn base, one, acc;
+    bignum_to_mont(a, &base, ctx);
+    bignum_from_int(&one, 1);
+    bignum_to_mont(&one, &one, ctx);
+    _bnw_mont_pow(base.array, e->array, BN_ARRAY_SIZE, acc.array, one.array,
+                  ctx->m.array, ctx->minv, BN_ARRAY_SIZE, t, table);
+    bignum_from_mont(&acc, c, ctx);
+}
+
+/* c = a b mod m over the full double width product */
+static void _bignum_mul_mod_wide(struct bn* a, struct bn* b, struct bn* c, struct bn* m)
+{
+    DTYPE prod[2 * BN_ARRAY_SIZE];
+    _bnw_mul(a->array, b->array, prod, BN_ARRAY_SIZE);
+    _bnw_div(prod, 2 * BN_ARRAY_SIZE, m->array, BN_ARRAY_SIZE, NULL, c->array);
+}
+
+/* Odd moduli go through a Montgomery context set up for the call, an even
+   one falls back to square and multiply with long division */
+void bignum_pow_mod(struct bn* a, struct bn* e, struct bn* m, struct bn* c)
+{
+    if (m->array[0] & 1)
+    {
+        bn_mont_ctx ctx;
+        struct bn base;
+        bignum_mont_init(&ctx, m);
+        bignum_mod(a, m, &base);
+        bignum_mont_pow(&base, e, c, &ctx);
+        return;
+    }
+
+    struct bn base, acc;
+    bignum_mod(a, m, &base);
+    bignum_from_int(&acc, 1);
+    bignum_mod(&acc, m, &acc);
+    for (int i = bignum_bit_length(e) - 1; i >= 0; --i)
+    {
+        _bignum_mul_mod_wide(&acc, &acc, &acc, m);
+        if (_bnw_bit(e->array, i))
+        {
+            _bignum_mul_mod_wide(&acc, &base, &acc, m);
+        }
+    }
+    bignum_copy(c, &acc);
+}
@@ -0,0 +1,194 @@
+#include <inc/chacha20.h>
+#include <inc/string.h>
+#include <inc/x86.h>
+#ifdef JOS_KERNEL
+#include <inc/mmu.h>
+#endif
+
+#define ROTL32(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+
+/* Works on scalars and on GCC vectors alike */
+#define QUARTERROUND(x, a, b, c, d)                      \
+    do {                                                 \
+        x[a] += x[b]; x[d] ^= x[a]; x[d] = ROTL32(x[d], 16); \
+        x[c] += x[d]; x[b] ^= x[c]; x[b] = ROTL32(x[b], 12); \
+        x[a] += x[b]; x[d] ^= x[a]; x[d] = ROTL32(x[d], 8);  \
+        x[c] += x[d]; x[b] ^= x[c]; x[b] = ROTL32(x[b], 7);  \
+    } while (0)
+
+#define DOUBLEROUND(x)                   \
+    do {                                 \
+        QUARTERROUND(x, 0, 4, 8, 12);    \
+        QUARTERROUND(x, 1, 5, 9, 13);    \
+        QUARTERROUND(x, 2, 6, 10, 14);   \
+        QUARTERROUND(x, 3, 7, 11, 15);   \
+        QUARTERROUND(x, 0, 5, 10, 15);   \
+        QUARTERROUND(x, 1, 6, 11, 12);   \
+        QUARTERROUND(x, 2, 7, 8, 13);    \
+        QUARTERROUND(x, 3, 4, 9, 14);    \
+    } while (0)
+
+static void chacha20_block_scalar(const uint32_t *in, uint32_t *out) {
+    uint32_t x[CHACHA20_BLOCK_WORDS];
+    for (int i = 0; i < CHACHA20_BLOCK_WORDS; i++) {
+        x[i] = in[i];
+    }
+    for (int i = 0; i < 10; i++) {
+        DOUBLEROUND(x);
+    }
+    for (int i = 0; i < CHACHA20_BLOCK_WORDS; i++) {
+        out[i] = x[i] + in[i];
+    }
+}
+
+/* {lanes} consecutive blocks per pass, lane l of x[i] is word i of block l.
+ * The rest of the kernel is built with -mno-sse, vector code is enabled
+ * per function and vector values never cross a function boundary. */
+#define CHACHA20_VECTOR_KERNEL(name, isa, lanes)                                  \
+    typedef uint32_t name##_vec __attribute__((vector_size(4 * (lanes))));        \
+    __attribute__((target(isa))) static void                                      \
+    name(const uint32_t *in, uint32_t *out) {                                     \
+        name##_vec x[CHACHA20_BLOCK_WORDS], orig[CHACHA20_BLOCK_WORDS];           \
+        uint64_t ctr = ((uint64_t)in[13] << 32) | in[12];                         \
+        for (int i = 0; i < CHACHA20_BLOCK_WORDS; i++) {                          \
+            for (int l = 0; l < (lanes); l++) {                                   \
+                x[i][l] = in[i];                                                  \
+            }                                                                     \
+        }                                                                         \
+        for (int l = 0; l < (lanes); l++) {                                       \
+            x[12][l] = (uint32_t)(ctr + l);                                       \
+            x[13][l] = (uint32_t)((ctr + l) >> 32);                               \
+        }                                                                         \
+        for (int i = 0; i < CHACHA20_BLOCK_WORDS; i++) {                          \
+            orig[i] = x[i];                                                       \
+        }                                                                         \
+        for (int i = 0; i < 10; i++) {                                            \
+            DOUBLEROUND(x);                                                       \
+        }                                                                         \
+        for (int i = 0; i < CHACHA20_BLOCK_WORDS; i++) {                          \
+            x[i] += orig[i];                                                      \
+        }                                                                         \
+        for (int l = 0; l < (lanes); l++) {                                       \
+            for (int i = 0; i < CHACHA20_BLOCK_WORDS; i++) {                      \
+                out[l * CHACHA20_BLOCK_WORDS + i] = x[i][l];                      \
+            }                                                                     \
+        }                                                                         \
+    }
+
+CHACHA20_VECTOR_KERNEL(chacha20_blocks_sse2, "sse2", 4)
+CHACHA20_VECTOR_KERNEL(chacha20_blocks_avx2, "avx2", 8)
+
+static const struct {
+    const char *name;
+    void (*func)(const uint32_t *in, uint32_t *out);
+    size_t blocks;
+} chacha20_impls[CHACHA20_NIMPL] = {
+        [CHACHA20_SCALAR] = {"scalar", chacha20_block_scalar, 1},
+        [CHACHA20_SSE2] = {"sse2", chacha20_blocks_sse2, 4},
+        [CHACHA20_AVX2] = {"avx2", chacha20_blocks_avx2, 8},
+};
+
+static bool chacha20_probed = 0;
+static bool chacha20_supported[CHACHA20_NIMPL];
+static enum chacha20_impl chacha20_impl = CHACHA20_SCALAR;
+
+/* The CPU having the instructions is not enough, the OS must have enabled
+ * the register state: CR4.OSFXSR for SSE, XCR0 bits 1-2 for AVX.
+ * The probe reads CR4, which faults in user mode, so it is only built
+ * under JOS_KERNEL and user environments stay on the scalar kernel. */
+static void chacha20_probe(void) {
+    chacha20_supported[CHACHA20_SCALAR] = 1;
+#ifdef JOS_KERNEL
+    uint32_t max_leaf, ecx, edx, ebx = 0;
+    cpuid(0, &max_leaf, NULL, NULL, NULL);
+    cpuid(1, NULL, NULL, &ecx, &edx);
+    if (max_leaf >= 7) {
+        cpuid_count(7, 0, NULL, &ebx, NULL, NULL);
+    }
+    bool sse2 = ((edx >> 26) & 1) && (rcr4() & CR4_OSFXSR);
+    bool osxsave = (ecx >> 27) & 1, avx = (ecx >> 28) & 1;
+    chacha20_supported[CHACHA20_SSE2] = sse2;
+    chacha20_supported[CHACHA20_AVX2] = sse2 && osxsave && avx && ((ebx >> 5) & 1) &&
+                                        (xgetbv(0) & 6) == 6;
+#endif
+    for (int i = 0; i < CHACHA20_NIMPL; i++) {
+        if (chacha20_supported[i]) {
+            chacha20_impl = i;
+        }
+    }
+    chacha20_probed = 1;
+}
+
+bool chacha20_impl_supported(enum chacha20_impl impl) {
+    if (!chacha20_probed) {
+        chacha20_probe();
+    }
+    return impl < CHACHA20_NIMPL && chacha20_supported[impl];
+}
+
+bool chacha20_set_impl(enum chacha20_impl impl) {
+    if (!chacha20_impl_supported(impl)) {
+        return 0;
+    }
+    chacha20_impl = impl;
+    return 1;
+}
+
+enum chacha20_impl chacha20_get_impl(void) {
+    if (!chacha20_probed) {
+        chacha20_probe();
+    }
+    return chacha20_impl;
+}
+
+const char *chacha20_impl_name(enum chacha20_impl impl) {
+    return impl < CHACHA20_NIMPL ? chacha20_impls[impl].name : "unknown";
+}
+
+void chacha20_init(struct chacha20_state *s, const uint32_t key[CHACHA20_KEY_WORDS], uint64_t nonce) {
+    /* "expand 32-byte k" */
+    s->input[0] = 0x61707865;
+    s->input[1] = 0x3320646e;
+    s->input[2] = 0x79622d32;
+    s->input[3] = 0x6b206574;
+    for (int i = 0; i < CHACHA20_KEY_WORDS; i++) {
+        s->input[4 + i] = key[i];
+    }
+    s->input[12] = 0;
+    s->input[13] = 0;
+    s->input[14] = (uint32_t)nonce;
+    s->input[15] = (uint32_t)(nonce >> 32);
+}
+
+void chacha20_rekey(struct chacha20_state *s, const uint32_t key[CHACHA20_KEY_WORDS]) {
+    for (int i = 0; i < CHACHA20_KEY_WORDS; i++) {
+        s->input[4 + i] = key[i];
+    }
+}
+
+static inline void chacha20_advance(struct chacha20_state *s, size_t nblocks) {
+    uint64_t ctr = ((uint64_t)s->input[13] << 32) | s->input[12];
+    ctr += nblocks;
+    s->input[12] = (uint32_t)ctr;
+    s->input[13] = (uint32_t)(ctr >> 32);
+}
+
+void chacha20_blocks(struct chacha20_state *s, uint32_t *out, size_t nblocks) {
+    enum chacha20_impl impl = chacha20_get_impl();
+
+    /* Wide passes first, the remainder one block at a time */
+    if (impl != CHACHA20_SCALAR) {
+        size_t step = chacha20_impls[impl].blocks;
+        while (nblocks >= step) {
+            chacha20_impls[impl].func(s->input, out);
+            chacha20_advance(s, step);
+            out += step * CHACHA20_BLOCK_WORDS;
+            nblocks -= step;
+        }
+    }
+    while (nblocks--) {
+        chacha20_block_scalar(s->input, out);
+        chacha20_advance(s, 1);
+        out += CHACHA20_BLOCK_WORDS;
+    }
+}
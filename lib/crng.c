@@ -6,38 +6,362 @@
 #include <inc/rand_isaac.h>
 #include <inc/crng.h>
 #include <inc/x86.h>
+#include <inc/string.h>
+#include <inc/entropy.h>
+#include <inc/bn.h>
+#ifdef JOS_KERNEL
+#include <kern/sched.h>
+#else
+#include <inc/lib.h>
+#endif
+
+#if ISAAC_BITS != 64
+#error "isaac_stream expects 64-bit ISAAC words"
+#endif
 
 extern bool InternalX86RdRand32(uint32_t *Rand); 
 extern bool InternalX86RdRand64(uint64_t *Rand);
+extern bool InternalX86RdSeed64(uint64_t *Seed);
+
+struct crng_hw_stats crng_hw_stats;
+
+static bool hw_probed = 0;
+static bool hw_rdrand = 0, hw_rdseed = 0;
 
-struct isaac_state isaac_state;
-bool isaac_initialized = 0;
+static struct isaac_stream rdrand_stream;
+static bool rdrand_stream_initialized = 0;
 
-volatile uint64_t s_entropy[32];
-volatile size_t s_entropy_begin = 0, s_entropy_end = 0;
+static struct chacha_stream chacha_stream;
+static bool chacha_stream_initialized = 0;
+
+#ifdef JOS_KERNEL
+/* Timing samples collected by the scheduler */
+struct entropy_ring sched_entropy;
+#endif
+
+/* Collect {n} seed words, from the bulk source first */
+static void gather_seed(uint64_t (*seed_func)(void), size_t (*harvest_func)(uint64_t *words, size_t n),
+                        uint64_t *seed, size_t n) {
+    size_t i = harvest_func ? harvest_func(seed, n) : 0;
+    for (; i < n; i++) {
+        seed[i] = seed_func();
+    }
+}
+
+/* Collect one state worth of seed words */
+static void isaac_stream_gather(struct isaac_stream *s, isaac_word seed[ISAAC_WORDS]) {
+    gather_seed(s->seed_func, s->harvest_func, seed, ISAAC_WORDS);
+}
+
+void isaac_stream_init(struct isaac_stream *s, uint64_t (*seed_func)(void),
+                       size_t (*harvest_func)(uint64_t *words, size_t n)) {
+    s->seed_func = seed_func;
+    s->harvest_func = harvest_func;
+    isaac_stream_gather(s, s->state.m);
+    isaac_seed(&s->state);
+    s->reseed_interval = ISAAC_STREAM_RESEED_BYTES;
+    s->since_reseed = 0;
+    /* Empty buffer: the first read triggers a refill */
+    s->pos = ISAAC_BYTES;
+}
 
-void initialize_isaac(void) {
+/* Mixes fresh seed words into the current state, so the new state depends
+ * both on the old one and on the new entropy. Buffered output is dropped. */
+void isaac_stream_reseed(struct isaac_stream *s) {
+    isaac_word seed[ISAAC_WORDS];
+    isaac_stream_gather(s, seed);
     for (int i = 0; i < ISAAC_WORDS; i++) {
-        isaac_state.m[i] = secure_rand64_rdrand(); 
+        s->state.m[i] ^= seed[i];
+    }
+    isaac_seed(&s->state);
+    s->since_reseed = 0;
+    s->pos = ISAAC_BYTES;
+}
+
+static inline void isaac_stream_refill(struct isaac_stream *s, isaac_word *out) {
+    if (s->reseed_interval && s->since_reseed >= s->reseed_interval) {
+        isaac_stream_reseed(s);
+    }
+    isaac_refill(&s->state, out);
+    s->since_reseed += ISAAC_BYTES;
+}
+
+/* Reserves the next {size} bytes of output, refilling the buffer when it
+ * is exhausted, and returns their offset in the buffer. Reads are aligned
+ * to {size}, so a 64-bit read following an odd number of 32-bit reads
+ * skips one 32-bit half. */
+static inline size_t isaac_stream_take(struct isaac_stream *s, size_t size) {
+    size_t pos = (s->pos + size - 1) & ~(size - 1);
+    if (pos + size > ISAAC_BYTES) {
+        isaac_stream_refill(s, s->buf);
+        pos = 0;
+    }
+    s->pos = pos + size;
+    return pos;
+}
+
+uint64_t isaac_stream_next64(struct isaac_stream *s) {
+    size_t pos = isaac_stream_take(s, sizeof(uint64_t));
+    return s->buf[pos / sizeof(isaac_word)];
+}
+
+uint32_t isaac_stream_next32(struct isaac_stream *s) {
+    size_t pos = isaac_stream_take(s, sizeof(uint32_t));
+    return (uint32_t)(s->buf[pos / sizeof(isaac_word)] >> ((pos % sizeof(isaac_word)) * 8));
+}
+
+void isaac_stream_fill(struct isaac_stream *s, void *buf, size_t len) {
+    uint8_t *dst = buf;
+
+    /* Leftover of the current block */
+    size_t avail = ISAAC_BYTES - s->pos;
+    if (avail > len) avail = len;
+    memcpy(dst, (uint8_t *)s->buf + s->pos, avail);
+    s->pos += avail;
+    dst += avail;
+    len -= avail;
+
+    /* Whole blocks go straight to the caller when it is word aligned */
+    while (len >= ISAAC_BYTES) {
+        if ((uintptr_t)dst % sizeof(isaac_word) == 0) {
+            isaac_stream_refill(s, (isaac_word *)dst);
+        } else {
+            isaac_stream_refill(s, s->buf);
+            memcpy(dst, s->buf, ISAAC_BYTES);
+            s->pos = ISAAC_BYTES;
+        }
+        dst += ISAAC_BYTES;
+        len -= ISAAC_BYTES;
+    }
+
+    /* Partial tail, the rest of the block stays buffered */
+    if (len) {
+        isaac_stream_refill(s, s->buf);
+        memcpy(dst, s->buf, len);
+        s->pos = len;
+    }
+}
+
+/* 64-bit seed words per ChaCha20 key */
+#define CHACHA_SEED_WORDS (CHACHA20_KEY_WORDS / 2)
+
+void chacha_stream_init(struct chacha_stream *s, uint64_t (*seed_func)(void),
+                        size_t (*harvest_func)(uint64_t *words, size_t n)) {
+    uint64_t seed[CHACHA_SEED_WORDS];
+    uint32_t key[CHACHA20_KEY_WORDS];
+    s->seed_func = seed_func;
+    s->harvest_func = harvest_func;
+    gather_seed(seed_func, harvest_func, seed, CHACHA_SEED_WORDS);
+    for (int i = 0; i < CHACHA_SEED_WORDS; i++) {
+        key[2 * i] = (uint32_t)seed[i];
+        key[2 * i + 1] = (uint32_t)(seed[i] >> 32);
+    }
+    chacha20_init(&s->state, key, 0);
+    memset(seed, 0, sizeof(seed));
+    memset(key, 0, sizeof(key));
+    s->reseed_interval = CHACHA_STREAM_RESEED_BYTES;
+    s->since_reseed = 0;
+    /* Empty buffer: the first read triggers a refill */
+    s->pos = CHACHA_STREAM_BYTES;
+}
+
+/* The new key is the next keystream block XORed with fresh seed words,
+ * so it depends both on the old key and on the new entropy.
+ * Buffered output is dropped. */
+void chacha_stream_reseed(struct chacha_stream *s) {
+    uint64_t seed[CHACHA_SEED_WORDS];
+    uint32_t block[CHACHA20_BLOCK_WORDS];
+    gather_seed(s->seed_func, s->harvest_func, seed, CHACHA_SEED_WORDS);
+    chacha20_blocks(&s->state, block, 1);
+    for (int i = 0; i < CHACHA_SEED_WORDS; i++) {
+        block[2 * i] ^= (uint32_t)seed[i];
+        block[2 * i + 1] ^= (uint32_t)(seed[i] >> 32);
+    }
+    chacha20_rekey(&s->state, block);
+    memset(seed, 0, sizeof(seed));
+    memset(block, 0, sizeof(block));
+    memset(s->buf, 0, sizeof(s->buf));
+    s->since_reseed = 0;
+    s->pos = CHACHA_STREAM_BYTES;
+}
+
+/* Refills the buffer, its first words become the next key */
+static void chacha_stream_refill(struct chacha_stream *s) {
+    if (s->reseed_interval && s->since_reseed >= s->reseed_interval) {
+        chacha_stream_reseed(s);
+    }
+    chacha20_blocks(&s->state, s->buf, CHACHA_STREAM_BLOCKS);
+    chacha20_rekey(&s->state, s->buf);
+    memset(s->buf, 0, CHACHA20_KEY_WORDS * sizeof(uint32_t));
+    s->since_reseed += CHACHA_STREAM_BYTES;
+    s->pos = CHACHA20_KEY_WORDS * sizeof(uint32_t);
+}
+
+/* Same as isaac_stream_take(), handed out words are wiped by the caller */
+static inline size_t chacha_stream_take(struct chacha_stream *s, size_t size) {
+    size_t pos = (s->pos + size - 1) & ~(size - 1);
+    if (pos + size > CHACHA_STREAM_BYTES) {
+        chacha_stream_refill(s);
+        pos = s->pos;
+    }
+    s->pos = pos + size;
+    return pos;
+}
+
+uint64_t chacha_stream_next64(struct chacha_stream *s) {
+    size_t i = chacha_stream_take(s, sizeof(uint64_t)) / sizeof(uint32_t);
+    uint64_t res = ((uint64_t)s->buf[i + 1] << 32) | s->buf[i];
+    s->buf[i] = s->buf[i + 1] = 0;
+    return res;
+}
+
+uint32_t chacha_stream_next32(struct chacha_stream *s) {
+    size_t i = chacha_stream_take(s, sizeof(uint32_t)) / sizeof(uint32_t);
+    uint32_t res = s->buf[i];
+    s->buf[i] = 0;
+    return res;
+}
+
+/* Copies out of the buffer and wipes what was handed out */
+static inline size_t chacha_stream_copy(struct chacha_stream *s, uint8_t *dst, size_t len) {
+    size_t avail = CHACHA_STREAM_BYTES - s->pos;
+    if (avail > len) avail = len;
+    memcpy(dst, (uint8_t *)s->buf + s->pos, avail);
+    memset((uint8_t *)s->buf + s->pos, 0, avail);
+    s->pos += avail;
+    return avail;
+}
+
+void chacha_stream_fill(struct chacha_stream *s, void *buf, size_t len) {
+    uint8_t *dst = buf;
+    size_t n = chacha_stream_copy(s, dst, len);
+    dst += n;
+    len -= n;
+
+    /* Whole blocks go straight to the caller when it is word aligned,
+     * in chunks that keep the reseed interval */
+    if (len >= CHACHA20_BLOCK_BYTES && (uintptr_t)dst % sizeof(uint32_t) == 0) {
+        size_t nblocks = len / CHACHA20_BLOCK_BYTES;
+        while (nblocks) {
+            size_t chunk = CHACHA_STREAM_RESEED_BYTES / CHACHA20_BLOCK_BYTES;
+            if (chunk > nblocks) chunk = nblocks;
+            if (s->reseed_interval && s->since_reseed >= s->reseed_interval) {
+                chacha_stream_reseed(s);
+            }
+            chacha20_blocks(&s->state, (uint32_t *)dst, chunk);
+            s->since_reseed += chunk * CHACHA20_BLOCK_BYTES;
+            dst += chunk * CHACHA20_BLOCK_BYTES;
+            len -= chunk * CHACHA20_BLOCK_BYTES;
+            nblocks -= chunk;
+        }
+        /* Rekey even if there is no tail to serve */
+        chacha_stream_refill(s);
+    }
+
+    while (len) {
+        if (s->pos == CHACHA_STREAM_BYTES) {
+            chacha_stream_refill(s);
+        }
+        n = chacha_stream_copy(s, dst, len);
+        dst += n;
+        len -= n;
+    }
+}
+
+static inline void initialize_chacha(void) {
+    chacha_stream_init(&chacha_stream, secure_rand64_rdrand, crng_rdseed_harvest);
+    chacha_stream_initialized = 1;
+}
+
+static inline void initialize_isaac(void) {
+    isaac_stream_init(&rdrand_stream, secure_rand64_rdrand, crng_rdseed_harvest);
+    rdrand_stream_initialized = 1;
+}
+
+void crng_hw_init(void) {
+    uint32_t max_leaf, ecx, ebx;
+    cpuid(0, &max_leaf, NULL, NULL, NULL);
+    cpuid(1, NULL, NULL, &ecx, NULL);
+    hw_rdrand = (ecx >> 30) & 1;
+    if (max_leaf >= 7) {
+        cpuid_count(7, 0, NULL, &ebx, NULL, NULL);
+        hw_rdseed = (ebx >> 18) & 1;
+    }
+    hw_probed = 1;
+}
+
+bool crng_has_rdrand(void) {
+    if (!hw_probed) {
+        crng_hw_init();
+    }
+    return hw_rdrand;
+}
+
+bool crng_has_rdseed(void) {
+    if (!hw_probed) {
+        crng_hw_init();
+    }
+    return hw_rdseed;
+}
+
+/* RDRAND may transiently fail when the DRNG is drained, retrying a few
+ * times is enough unless the hardware is broken */
+static inline bool rdrand64_retry(uint64_t *res) {
+    for (int i = 0; i < RDRAND_RETRIES; i++) {
+        if (InternalX86RdRand64(res)) {
+            return 1;
+        }
+        crng_hw_stats.rdrand_retries++;
+    }
+    crng_hw_stats.rdrand_failures++;
+    return 0;
+}
+
+/* RDSEED runs out of entropy much more easily, back off with pause */
+static inline bool rdseed64_retry(uint64_t *res) {
+    for (int i = 0; i < RDSEED_RETRIES; i++) {
+        if (InternalX86RdSeed64(res)) {
+            return 1;
+        }
+        crng_hw_stats.rdseed_retries++;
+        asm volatile("pause");
+    }
+    crng_hw_stats.rdseed_failures++;
+    return 0;
+}
+
+size_t crng_rdseed_harvest(uint64_t *words, size_t n) {
+    size_t i = 0;
+    if (!crng_has_rdseed()) {
+        return 0;
+    }
+    while (i < n && rdseed64_retry(&words[i])) {
+        i++;
+    }
+    crng_hw_stats.rdseed_words += i;
+    return i;
+}
+
+void crng_reseed_rdseed(void) {
+    if (!rdrand_stream_initialized) {
+        initialize_isaac();
+    } else {
+        isaac_stream_reseed(&rdrand_stream);
     }
-    isaac_seed(&isaac_state);
-    isaac_initialized = 1;
 }
 
 uint64_t secure_rand64_rdrand(void) {
     uint64_t res;
-    uint32_t rdrand_enabled;
     static bool first_call = true;
-    cpuid(0, NULL, NULL, &rdrand_enabled, NULL);
-    rdrand_enabled >>= 29u;
-    rdrand_enabled &= 1u;
-    if (!rdrand_enabled || !InternalX86RdRand64(&res)) {
-        if (first_call) {
-            res = secure_rand64_doom();
-            first_call = false;
-        } else {
-            res = secure_urand64_doom();
-        }
+    if (crng_has_rdrand() && rdrand64_retry(&res)) {
+        return res;
+    }
+    crng_hw_stats.doom_fallbacks++;
+    if (first_call) {
+        res = secure_rand64_doom();
+        first_call = false;
+    } else {
+        res = secure_urand64_doom();
     }
     return res;
 }
@@ -47,45 +371,268 @@ uint32_t secure_rand32_rdrand(void) {
 }
 
 uint64_t secure_urand64_rdrand(void) {
+    if (!rdrand_stream_initialized) {
+        initialize_isaac();
+    }
+    return isaac_stream_next64(&rdrand_stream);
+}
+
+uint32_t secure_urand32_rdrand(void) {
+    if (!rdrand_stream_initialized) {
+        initialize_isaac();
+    }
+    return isaac_stream_next32(&rdrand_stream);
+}
+
+void crng_fill_rdrand(void *buf, size_t len) {
+    if (!rdrand_stream_initialized) {
+        initialize_isaac();
+    }
+    isaac_stream_fill(&rdrand_stream, buf, len);
+}
+
+uint64_t secure_urand64_chacha(void) {
+    if (!chacha_stream_initialized) {
+        initialize_chacha();
+    }
+    return chacha_stream_next64(&chacha_stream);
+}
+
+uint32_t secure_urand32_chacha(void) {
+    if (!chacha_stream_initialized) {
+        initialize_chacha();
+    }
+    return chacha_stream_next32(&chacha_stream);
+}
+
+void crng_fill_chacha(void *buf, size_t len) {
+    if (!chacha_stream_initialized) {
+        initialize_chacha();
+    }
+    chacha_stream_fill(&chacha_stream, buf, len);
+}
+
+const struct crng_backend crng_backends[CRNG_NBACKENDS] = {
+        {"rdrand", secure_urand64_rdrand, secure_urand32_rdrand, crng_fill_rdrand},
+        {"doom", secure_urand64_doom, secure_urand32_doom, crng_fill_doom},
+        {"chacha", secure_urand64_chacha, secure_urand32_chacha, crng_fill_chacha},
+};
+
+static const struct crng_backend *crng_current = &crng_backends[2];
+
+const struct crng_backend *crng_backend(void) {
+    return crng_current;
+}
+
+const struct crng_backend *crng_backend_find(const char *name) {
+    for (int i = 0; i < CRNG_NBACKENDS; i++) {
+        if (!strcmp(crng_backends[i].name, name)) {
+            return &crng_backends[i];
+        }
+    }
+    return NULL;
+}
+
+bool crng_backend_select(const char *name) {
+    const struct crng_backend *b = crng_backend_find(name);
+    if (b) {
+        crng_current = b;
+    }
+    return b != NULL;
+}
+
+void crng_fill(void *buf, size_t len) {
+    crng_current->fill(buf, len);
+}
+
+uint64_t secure_urand64_rdrand_refill(void) {
     isaac_word arr[ISAAC_WORDS];
-    if (!isaac_initialized) {
+    if (!rdrand_stream_initialized) {
         initialize_isaac();
     }
-    isaac_refill(&isaac_state, arr);
+    isaac_refill(&rdrand_stream.state, arr);
     return arr[0];
 }
 
-uint32_t secure_urand32_rdrand(void) {
-    return (uint32_t)secure_urand64_rdrand();
+/* Blum-Blum-Shub over a 1024-bit Blum integer M = p * q, p and q safe
+ * primes congruent to 3 mod 4. M is the output of ./bbs-modulus.py, which
+ * checks p, q, (p - 1) / 2 and (q - 1) / 2 for primality and then drops the
+ * factors; rerun it to replace M. Shared by secure_urand64_doom() and
+ * crng_fill_doom().
+ *
+ * The state is kept in Montgomery form y = x * R mod M, so a step is a
+ * single Montgomery squaring. Every step outputs the low bbs_bits bits
+ * of x = y / R mod M, bbs_bits = floor(log2(log2 M)) is the number of
+ * bits that stay as hard to predict as factoring M. */
+static struct bn bbs_M = {{
+    0xb575f061, 0x1d9c4efd, 0x7cffaa61, 0x96160c85,
+    0x37ad3316, 0x18576ed1, 0xe0b393ba, 0xd926b6a5,
+    0xf7fb0ce9, 0xd002be56, 0x8505cb88, 0x26918fe7,
+    0x2c278e3c, 0x65c55533, 0x73fe5e67, 0x7e0fdbdd,
+    0x8c1815db, 0xfe3f2fba, 0x36f110a0, 0x20a60059,
+    0x66a5ffee, 0x97173d04, 0xbd3be775, 0xa77c0fbf,
+    0x8746186d, 0x4bd747cb, 0x41db8acc, 0xe7366ef9,
+    0xfa86da10, 0xf3f055e9, 0xb4495c61, 0xdd3abc3e,
+}};
+static struct bn bbs_y;
+static bn_mont_ctx bbs_mont;
+static int bbs_bits;
+/* Output bits of the last step not handed out yet */
+static uint64_t bbs_out;
+static int bbs_out_bits;
+static bool bbs_seeded = 0;
+
+/* Words of BBS output after which crng_fill_doom() mixes in new entropy,
+ * if the scheduler has collected enough of it */
+#define BBS_RESEED_WORDS 4096
+/* 64-bit doom values mixed into the state on (re)seed. They land in the
+ * low words of y, x = y / R mod M is still spread over the whole range. */
+#define BBS_SEED_WORDS 4
+
+static inline void bbs_mix(void) {
+    for (int i = 0; i < BBS_SEED_WORDS; i++) {
+        uint64_t seed = secure_rand64_doom();
+        bbs_y.array[2 * i] ^= (uint32_t)seed;
+        bbs_y.array[2 * i + 1] ^= (uint32_t)(seed >> 32);
+    }
+    if (bignum_cmp(&bbs_y, &bbs_M) != SMALLER) {
+        struct bn tmp;
+        bignum_sub(&bbs_y, &bbs_M, &tmp);
+        bignum_copy(&bbs_y, &tmp);
+    }
+    /* 0 is a fixed point */
+    if (bignum_is_zero(&bbs_y)) {
+        bbs_y.array[0] = 2;
+    }
 }
 
-uint64_t secure_urand64_doom(void) {
-    static int first_call = 0;
-    static uint64_t x = 0;
-    static uint64_t M;
-    if (!first_call) {
+static inline void bbs_seed(void) {
+    int log_bits = 0;
+    for (int n = bignum_bit_length(&bbs_M); n > 1; n >>= 1) {
+        log_bits++;
+    }
+    bbs_bits = log_bits;
+    bignum_mont_init(&bbs_mont, &bbs_M);
+    bignum_init(&bbs_y);
+    bbs_mix();
+    bbs_out_bits = 0;
+    bbs_seeded = 1;
+}
+
+static inline void bbs_reseed(void) {
+    bbs_mix();
+}
+
+/* One squaring, returns its bbs_bits output bits */
+static inline uint64_t bbs_step(void) {
+    struct bn tmp, x;
+    bignum_mont_sqr(&bbs_y, &tmp, &bbs_mont);
+    bignum_copy(&bbs_y, &tmp);
+    bignum_from_mont(&bbs_y, &x, &bbs_mont);
+    return x.array[0] & ((1U << bbs_bits) - 1);
+}
+
+static inline uint64_t bbs_next64(void) {
+    uint64_t res = bbs_out;
+    int have = bbs_out_bits;
+    for (;;) {
+        uint64_t bits = bbs_step();
+        res |= bits << have;
+        if (have + bbs_bits >= 64) {
+            int used = 64 - have;
+            bbs_out = used < bbs_bits ? bits >> used : 0;
+            bbs_out_bits = bbs_bits - used;
+            return res;
+        }
+        have += bbs_bits;
+    }
+}
+
+/* Previous generator: 64-bit modulus, one parity bit per squaring */
+static uint64_t bbs64_x = 0, bbs64_M;
+static bool bbs64_seeded = 0;
+
+uint64_t secure_urand64_doom_bbs64(void) {
+    if (!bbs64_seeded) {
         uint32_t p = 1215752191, q = 1215752173;
-        M = p * q;
-        x = secure_rand64_doom();
-        first_call = 1;
+        bbs64_M = p * q;
+        bbs64_x = secure_rand64_doom();
+        bbs64_seeded = 1;
     }
+    uint64_t x = bbs64_x;
     uint64_t result = x & 1U;
     for (int pow = 1; pow < 64; pow++) {
-        x = (x * x) % M;
+        x = (x * x) % bbs64_M;
         result = (result << 1U) | (x & 1U);
     }
+    bbs64_x = x;
     return result;
 }
 
+#ifdef JOS_KERNEL
+static inline bool doom_entropy_ready(void) {
+    return entropy_ring_credit(&sched_entropy) >= DOOM_SEED_BITS;
+}
+
+static void doom_entropy_sleep(void) {
+    /* The kernel is not preemptible, so the scheduler cannot run while we
+     * wait: take a (low credit) timing sample across a port access instead */
+    inb(0x80);
+    sched_entropy_sample(1);
+}
+#else
+/* Scheduler entropy lives in the kernel pool, getrandom() serves most
+ * requests from a local buffer without trapping */
+static inline bool doom_entropy_ready(void) {
+    return 1;
+}
+#endif
+
+uint64_t secure_urand64_doom(void) {
+    if (!bbs_seeded) {
+        bbs_seed();
+    }
+    return bbs_next64();
+}
+
+void crng_fill_doom(void *buf, size_t len) {
+    uint8_t *dst = buf;
+    size_t words = 0;
+    if (!bbs_seeded) {
+        bbs_seed();
+    }
+    while (len) {
+        if (++words % BBS_RESEED_WORDS == 0 && doom_entropy_ready()) {
+            bbs_reseed();
+        }
+        uint64_t res = bbs_next64();
+        size_t n = len < sizeof(res) ? len : sizeof(res);
+        memcpy(dst, &res, n);
+        dst += n;
+        len -= n;
+    }
+}
+
+#ifdef JOS_KERNEL
 uint64_t secure_rand64_doom(void) {
-    uint64_t res = 0;
-    while (s_entropy_end - s_entropy_begin < 16) {}
-    for (int i = 0; i < 16; i++) {
-        res <<= 4;
-        res += s_entropy[s_entropy_begin++] % 16u;
+    uint64_t res = 0, bits = 0;
+    struct entropy_sample sample;
+    entropy_ring_wait(&sched_entropy, DOOM_SEED_BITS, doom_entropy_sleep);
+    /* Single consumer: the credit we waited for cannot go away */
+    while (bits < DOOM_SEED_BITS && entropy_ring_pop(&sched_entropy, &sample)) {
+        /* Keep only the low bits the producer gave credit for */
+        res = (res << sample.bits) | (sample.value & ((1ULL << sample.bits) - 1));
+        bits += sample.bits;
     }
     return res;
 }
+#else
+uint64_t secure_rand64_doom(void) {
+    uint64_t res;
+    getrandom(&res, sizeof(res));
+    return res;
+}
+#endif
 
 uint32_t secure_urand32_doom(void) {
     return (uint32_t)secure_urand64_doom();
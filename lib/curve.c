@@ -8,7 +8,8 @@ curve test_curve =
                 "aboba",
                 "3",
                 "11",
-                "A"
+                "A",
+                192
 };
 
 curve p_192 = {
@@ -18,7 +19,8 @@ curve p_192 = {
         "3099d2bbbfcb2538542dcd5fb078b6ef5f3d6fe2c745de65",           //c
         "64210519e59c80e70fa7e9ab72243049feb8deecc146b9b1",           //b
         "188da80eb03090f67cbf20eb43a18800f4ff0afd82ff1012",           //Gx
-        "07192b95ffc8da78631011ed6b24cdd573f977a11e794811"            //Gy
+        "07192b95ffc8da78631011ed6b24cdd573f977a11e794811",           //Gy
+        192
 };
 
 curve p_224 = {
@@ -28,7 +30,8 @@ curve p_224 = {
         "5b056c7e11dd68f40469ee7f3c7a7d74f7d121116506d031218291fb",             //c
         "b4050a850c04b3abf54132565044b0b7d7bfd8ba270b39432355ffb4",             //b
         "b70e0cbd6bb4bf7f321390b94a03c1d356c21122343280d6115c1d21",             //Gx
-        "bd376388b5f723fb4c22dfe6cd4375a05a07476444d5819985007e34"              //Gy
+        "bd376388b5f723fb4c22dfe6cd4375a05a07476444d5819985007e34",             //Gy
+        224
 };
 
 curve p_256 = {
@@ -38,7 +41,8 @@ curve p_256 = {
         "7efba1662985be9403cb055c75d4f7e0ce8d84a9c5114abcaf3177680104fa0d",               //c
         "5ac635d8aa3a93e7b3ebbd55769886bc651d06b0cc53b0f63bce3c3e27d2604b",               //b
         "6b17d1f2e12c4247f8bce6e563a440f277037d812deb33a0f4a13945d898c296",               //Gx
-        "4fe342e2fe1a7f9b8ee7eb4a7c0f9e162bce33576b315ececbb6406837bf51f5"                //Gy
+        "4fe342e2fe1a7f9b8ee7eb4a7c0f9e162bce33576b315ececbb6406837bf51f5",               //Gy
+        256
 };
 
 curve p_384 = {
@@ -60,7 +64,8 @@ curve p_384 = {
         "59f741e082542a385502f25dbf55296c3a545e3872760ab7",           //Gx
 
         "3617de4a96262c6f5d9e98bf9292dc29f8f41dbd289a147c"
-        "e9da3113b5f0b8c00a60b1ce1d7e819d7a431d7c90ea0e5f"            //Gy
+        "e9da3113b5f0b8c00a60b1ce1d7e819d7a431d7c90ea0e5f",           //Gy
+        384
 };
 
 
@@ -235,4 +240,626 @@ void ellip_curve_init(bignum_curve_t* ellip_curve, curve* ellip)
     bignum_from_str_dex(&ellip_curve->SEED, ellip->SEED, strlen(ellip->SEED) + 1);
     bignum_from_str_dex(&ellip_curve->Gx, ellip->Gx, strlen(ellip->Gx) + 1);
     bignum_from_str_dex(&ellip_curve->Gy, ellip->Gy, strlen(ellip->Gy) + 1);
-}
\ No newline at end of file
+}
+
+
+/* Solinas reduction (FIPS 186-4, D.2) for the NIST primes. With 32-bit
+   limbs a_0 .. a_(2 words - 1) of a double width value, a mod p is a short
+   signed sum of words-limb numbers whose limbs are picked from a. Each
+   term below lists its limbs most significant first, as in the standard,
+   -1 for a zero limb. */
+#define SOLINAS_MAX_WORDS 12
+#define SOLINAS_MAX_TERMS 10
+
+struct solinas_term {
+    int coef;
+    int8_t limb[SOLINAS_MAX_WORDS];
+};
+
+struct solinas {
+    DTYPE p[SOLINAS_MAX_WORDS]; /* least significant limb first */
+    int nterms;
+    struct solinas_term term[SOLINAS_MAX_TERMS];
+};
+
+static const struct solinas solinas_192 = {
+        {0xffffffff, 0xffffffff, 0xfffffffe, 0xffffffff, 0xffffffff, 0xffffffff},
+        4, {
+                {+1, {5, 4, 3, 2, 1, 0}},               /* T */
+                {+1, {-1, -1, 7, 6, 7, 6}},             /* S1 */
+                {+1, {9, 8, 9, 8, -1, -1}},             /* S2 */
+                {+1, {11, 10, 11, 10, 11, 10}},         /* S3 */
+        }};
+
+static const struct solinas solinas_224 = {
+        {0x00000001, 0x00000000, 0x00000000, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff},
+        5, {
+                {+1, {6, 5, 4, 3, 2, 1, 0}},            /* T */
+                {+1, {10, 9, 8, 7, -1, -1, -1}},        /* S1 */
+                {+1, {-1, 13, 12, 11, -1, -1, -1}},     /* S2 */
+                {-1, {13, 12, 11, 10, 9, 8, 7}},        /* D1 */
+                {-1, {-1, -1, -1, -1, 13, 12, 11}},     /* D2 */
+        }};
+
+static const struct solinas solinas_256 = {
+        {0xffffffff, 0xffffffff, 0xffffffff, 0x00000000, 0x00000000, 0x00000000, 0x00000001, 0xffffffff},
+        9, {
+                {+1, {7, 6, 5, 4, 3, 2, 1, 0}},         /* T */
+                {+2, {15, 14, 13, 12, 11, -1, -1, -1}}, /* S1 */
+                {+2, {-1, 15, 14, 13, 12, -1, -1, -1}}, /* S2 */
+                {+1, {15, 14, -1, -1, -1, 10, 9, 8}},   /* S3 */
+                {+1, {8, 13, 15, 14, 13, 11, 10, 9}},   /* S4 */
+                {-1, {10, 8, -1, -1, -1, 13, 12, 11}},  /* D1 */
+                {-1, {11, 9, -1, -1, 15, 14, 13, 12}},  /* D2 */
+                {-1, {12, -1, 10, 9, 8, 15, 14, 13}},   /* D3 */
+                {-1, {13, -1, 11, 10, 9, -1, 15, 14}},  /* D4 */
+        }};
+
+static const struct solinas solinas_384 = {
+        {0xffffffff, 0x00000000, 0x00000000, 0xffffffff, 0xfffffffe, 0xffffffff,
+         0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff},
+        10, {
+                {+1, {11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0}},              /* T */
+                {+2, {-1, -1, -1, -1, -1, 23, 22, 21, -1, -1, -1, -1}},    /* S1 */
+                {+1, {23, 22, 21, 20, 19, 18, 17, 16, 15, 14, 13, 12}},    /* S2 */
+                {+1, {20, 19, 18, 17, 16, 15, 14, 13, 12, 23, 22, 21}},    /* S3 */
+                {+1, {19, 18, 17, 16, 15, 14, 13, 12, 20, -1, 23, -1}},    /* S4 */
+                {+1, {-1, -1, -1, -1, 23, 22, 21, 20, -1, -1, -1, -1}},    /* S5 */
+                {+1, {-1, -1, -1, -1, -1, -1, 23, 22, 21, -1, -1, 20}},    /* S6 */
+                {-1, {22, 21, 20, 19, 18, 17, 16, 15, 14, 13, 12, 23}},    /* D1 */
+                {-1, {-1, -1, -1, -1, -1, -1, -1, 23, 22, 21, 20, -1}},    /* D2 */
+                {-1, {-1, -1, -1, -1, -1, -1, -1, 23, 23, -1, -1, -1}},    /* D3 */
+        }};
+
+static int _bnw_equal(const DTYPE* a, const DTYPE* b, int words)
+{
+    for (int i = 0; i < words; ++i)
+        if (a[i] != b[i])
+            return 0;
+    return 1;
+}
+
+/* c = a mod p for a double width a. The columns of the signed sum are
+   added up in 64 bits and carried, what is left above the top limb is a
+   small multiple of 2^(32 words) that is folded back by adding or
+   subtracting p until the result is in [0, p). */
+static void solinas_reduce(const DTYPE* a, DTYPE* c, const struct solinas* s, int words)
+{
+    int64_t carry = 0;
+    for (int i = 0; i < words; ++i) {
+        for (int t = 0; t < s->nterms; ++t) {
+            int limb = s->term[t].limb[words - 1 - i];
+            if (limb >= 0)
+                carry += (int64_t)s->term[t].coef * a[limb];
+        }
+        c[i] = (DTYPE)carry;
+        carry >>= 32;
+    }
+
+    while (carry > 0) {
+        DTYPE_TMP borrow = 0;
+        for (int i = 0; i < words; ++i) {
+            DTYPE_TMP res = (DTYPE_TMP)c[i] - s->p[i] - borrow;
+            c[i] = (DTYPE)res;
+            borrow = (res >> 32) & 1;
+        }
+        carry -= borrow;
+    }
+    while (carry < 0) {
+        DTYPE_TMP sum = 0;
+        for (int i = 0; i < words; ++i) {
+            sum += (DTYPE_TMP)c[i] + s->p[i];
+            c[i] = (DTYPE)sum;
+            sum >>= 32;
+        }
+        carry += sum;
+    }
+    for (int i = words - 1; i >= 0; --i) {
+        if (c[i] != s->p[i]) {
+            if (c[i] < s->p[i])
+                return;
+            break;
+        }
+    }
+    DTYPE_TMP borrow = 0;
+    for (int i = 0; i < words; ++i) {
+        DTYPE_TMP res = (DTYPE_TMP)c[i] - s->p[i] - borrow;
+        c[i] = (DTYPE)res;
+        borrow = (res >> 32) & 1;
+    }
+}
+
+
+/* Width-w NAF of the {words}-limb k, least significant digit first: every
+   nonzero digit is odd and below 2^(w - 1) in magnitude, and is followed
+   by at least w - 1 zeros. Returns the number of digits, at most one more
+   than the bit length of k. */
+static int wnaf_digits(const DTYPE* k, int words, int w, int8_t* naf)
+{
+    DTYPE t[BN_ARRAY_SIZE + 1];
+    int len = 0;
+
+    for (int i = 0; i < words; ++i)
+        t[i] = k[i];
+    t[words] = 0;
+    for (;;) {
+        DTYPE any = 0;
+        for (int i = 0; i <= words; ++i)
+            any |= t[i];
+        if (!any)
+            return len;
+
+        int d = 0;
+        if (t[0] & 1) {
+            d = t[0] & ((1 << w) - 1);
+            if (d >= 1 << (w - 1))
+                d -= 1 << w;
+            /* t -= d clears the low w bits, only a negative d carries */
+            if (d > 0) {
+                t[0] -= d;
+            } else {
+                DTYPE_TMP carry = -d;
+                for (int i = 0; i <= words && carry; ++i) {
+                    carry += t[i];
+                    t[i] = (DTYPE)carry;
+                    carry >>= 8 * WORD_SIZE;
+                }
+            }
+        }
+        naf[len++] = (int8_t)d;
+        for (int i = 0; i < words; ++i)
+            t[i] = (t[i] >> 1) | (t[i + 1] << (8 * WORD_SIZE - 1));
+        t[words] >>= 1;
+    }
+}
+
+
+/* Width-specialized arithmetic: the code above with bn<bits> operands.
+   The result is only written once everything is computed, so p3 may be
+   p1 or p2, and elliptic_mul_<bits> needs no temporary points. */
+#define CURVE_DEFINE_WIDTH(bits)                                                                      \
+    void point##bits##_from_point(point##bits* dst, const point* src)                                 \
+    {                                                                                                 \
+        bn##bits##_from_bignum(&dst->x, &src->x);                                                     \
+        bn##bits##_from_bignum(&dst->y, &src->y);                                                     \
+        dst->zero_flag = src->zero_flag;                                                              \
+    }                                                                                                 \
+                                                                                                      \
+    void point##bits##_to_point(point* dst, const point##bits* src)                                   \
+    {                                                                                                 \
+        bn##bits##_to_bignum(&dst->x, &src->x);                                                       \
+        bn##bits##_to_bignum(&dst->y, &src->y);                                                       \
+        dst->zero_flag = src->zero_flag;                                                              \
+    }                                                                                                 \
+                                                                                                      \
+    void field##bits##_init(field##bits* f, const bn##bits* p)                                        \
+    {                                                                                                 \
+        bn##bits##_mont_init(&f->mont, p);                                                            \
+        f->solinas = WORD_SIZE == 4 && _bnw_equal(p->array, solinas_##bits.p, BN_WORDS(bits));        \
+        bn##bits##_from_int(&f->one, 1);                                                              \
+        field##bits##_encode(&f->one, &f->one, f);                                                    \
+    }                                                                                                 \
+                                                                                                      \
+    void field##bits##_encode(const bn##bits* a, bn##bits* c, const field##bits* f)                   \
+    {                                                                                                 \
+        if (f->solinas)                                                                               \
+            *c = *a;                                                                                  \
+        else                                                                                          \
+            bn##bits##_to_mont(a, c, &f->mont);                                                       \
+    }                                                                                                 \
+                                                                                                      \
+    void field##bits##_decode(const bn##bits* a, bn##bits* c, const field##bits* f)                   \
+    {                                                                                                 \
+        if (f->solinas)                                                                               \
+            *c = *a;                                                                                  \
+        else                                                                                          \
+            bn##bits##_from_mont(a, c, &f->mont);                                                     \
+    }                                                                                                 \
+                                                                                                      \
+    void field##bits##_mul(const bn##bits* a, const bn##bits* b, bn##bits* c, const field##bits* f)   \
+    {                                                                                                 \
+        bn##bits##w prod;                                                                             \
+        if (f->solinas) {                                                                             \
+            bn##bits##_mul(a, b, &prod);                                                              \
+            solinas_reduce(prod.array, c->array, &solinas_##bits, BN_WORDS(bits));                    \
+        } else {                                                                                      \
+            bn##bits##_mont_mul(a, b, c, &f->mont);                                                   \
+        }                                                                                             \
+    }                                                                                                 \
+                                                                                                      \
+    void field##bits##_sqr(const bn##bits* a, bn##bits* c, const field##bits* f)                      \
+    {                                                                                                 \
+        bn##bits##w prod;                                                                             \
+        if (f->solinas) {                                                                             \
+            bn##bits##_sqr(a, &prod);                                                                 \
+            solinas_reduce(prod.array, c->array, &solinas_##bits, BN_WORDS(bits));                    \
+        } else {                                                                                      \
+            bn##bits##_mont_sqr(a, c, &f->mont);                                                      \
+        }                                                                                             \
+    }                                                                                                 \
+                                                                                                      \
+    void field##bits##_reverse(const bn##bits* a, bn##bits* c, const field##bits* f)                  \
+    {                                                                                                 \
+        bn##bits tmp;                                                                                 \
+        field##bits##_decode(a, &tmp, f);                                                             \
+        bn##bits##_reverse(c, &tmp, &f->mont.m);                                                      \
+        field##bits##_encode(c, c, f);                                                                \
+    }                                                                                                 \
+                                                                                                      \
+    /* Montgomery's trick: c collects the prefix products a[0] ... a[i], the                          \
+       inverse of the last one is peeled back two products per element. */                            \
+    void field##bits##_batch_reverse(const bn##bits* a, bn##bits* c, int n, const field##bits* f)     \
+    {                                                                                                 \
+        bn##bits inv;                                                                                 \
+        if (n <= 0)                                                                                   \
+            return;                                                                                   \
+        c[0] = a[0];                                                                                  \
+        for (int i = 1; i < n; ++i)                                                                   \
+            field##bits##_mul(&c[i - 1], &a[i], &c[i], f);                                            \
+        field##bits##_reverse(&c[n - 1], &inv, f);                                                    \
+        for (int i = n - 1; i > 0; --i) {                                                             \
+            field##bits##_mul(&inv, &c[i - 1], &c[i], f); /* a[i] ^ -1 */                             \
+            field##bits##_mul(&inv, &a[i], &inv, f);      /* (a[0] ... a[i - 1]) ^ -1 */              \
+        }                                                                                             \
+        c[0] = inv;                                                                                   \
+    }                                                                                                 \
+                                                                                                      \
+    void point##bits##_encode(point##bits* dst, const point##bits* src, const field##bits* f)         \
+    {                                                                                                 \
+        field##bits##_encode(&src->x, &dst->x, f);                                                    \
+        field##bits##_encode(&src->y, &dst->y, f);                                                    \
+        dst->zero_flag = src->zero_flag;                                                              \
+    }                                                                                                 \
+                                                                                                      \
+    void point##bits##_decode(point##bits* dst, const point##bits* src, const field##bits* f)         \
+    {                                                                                                 \
+        field##bits##_decode(&src->x, &dst->x, f);                                                    \
+        field##bits##_decode(&src->y, &dst->y, f);                                                    \
+        dst->zero_flag = src->zero_flag;                                                              \
+    }                                                                                                 \
+                                                                                                      \
+    void elliptic_add_##bits(const point##bits* p1, const point##bits* p2, point##bits* p3,           \
+                             const bn##bits* a, const field##bits* p)                                 \
+    {                                                                                                 \
+        bn##bits neg_y, m, tmp, tmp2, x3, y3;                                                         \
+        if (p1->zero_flag == 1) {                                                                     \
+            *p3 = *p2;                                                                                \
+            return;                                                                                   \
+        }                                                                                             \
+        if (p2->zero_flag == 1) {                                                                     \
+            *p3 = *p1;                                                                                \
+            return;                                                                                   \
+        }                                                                                             \
+        bn##bits##_copy(&neg_y, &p1->y);                                                              \
+        bn##bits##_negate(&neg_y, &p->mont.m);                                                        \
+        if (bn##bits##_cmp(&p1->x, &p2->x) == EQUAL && bn##bits##_cmp(&neg_y, &p2->y) == EQUAL) {     \
+            p3->zero_flag = 1;                                                                        \
+            return;                                                                                   \
+        }                                                                                             \
+        if (bn##bits##_cmp(&p1->x, &p2->x) == EQUAL) {                                                \
+            field##bits##_sqr(&p1->x, &tmp, p);                 /* Px ^ 2 */                          \
+            bn##bits##_add_mod(&tmp, &tmp, &tmp2, &p->mont.m);                                        \
+            bn##bits##_add_mod(&tmp2, &tmp, &tmp2, &p->mont.m);      /* 3 Px ^ 2 */                   \
+            bn##bits##_add_mod(&tmp2, a, &m, &p->mont.m);            /* (3 Px ^ 2 + a) */             \
+            bn##bits##_add_mod(&p1->y, &p1->y, &tmp, &p->mont.m);    /* 2 Py */                       \
+        } else {                                                                                      \
+            bn##bits##_sub_mod(&p1->y, &p2->y, &m, &p->mont.m);      /* Py - Qy */                    \
+            bn##bits##_sub_mod(&p1->x, &p2->x, &tmp, &p->mont.m);    /* Px - Qx */                    \
+        }                                                                                             \
+        field##bits##_reverse(&tmp, &tmp2, p);                                                        \
+        field##bits##_mul(&m, &tmp2, &m, p);                    /* slope */                           \
+                                                                                                      \
+        field##bits##_sqr(&m, &tmp, p);                         /* m ^ 2 */                           \
+        bn##bits##_sub_mod(&tmp, &p1->x, &tmp, &p->mont.m);          /* m ^ 2 - Px */                 \
+        bn##bits##_sub_mod(&tmp, &p2->x, &x3, &p->mont.m);           /* m ^ 2 - Px - Qx */            \
+        bn##bits##_sub_mod(&p1->x, &x3, &tmp, &p->mont.m);           /* Px - Rx */                    \
+        field##bits##_mul(&m, &tmp, &tmp2, p);                  /* m * (Px - Rx) */                   \
+        bn##bits##_sub_mod(&tmp2, &p1->y, &y3, &p->mont.m);          /* m * (Px - Rx) - Py */         \
+        p3->x = x3;                                                                                   \
+        p3->y = y3;                                                                                   \
+        p3->zero_flag = 0;                                                                            \
+    }                                                                                                 \
+                                                                                                      \
+    /* Jacobian (X, Y, Z) stands for (X / Z^2, Y / Z^3), Z = 0 for the point                          \
+       at infinity. Doubling and adding need no inversion, only the final                             \
+       conversion back to affine pays for one. */                                                     \
+    void point##bits##_to_jacobian(jacobian##bits* dst, const point##bits* src, const field##bits* p) \
+    {                                                                                                 \
+        dst->X = src->x;                                                                              \
+        dst->Y = src->y;                                                                              \
+        if (src->zero_flag)                                                                           \
+            bn##bits##_init(&dst->Z);                                                                 \
+        else                                                                                          \
+            dst->Z = p->one;                                                                          \
+    }                                                                                                 \
+                                                                                                      \
+    void jacobian##bits##_to_point(point##bits* dst, const jacobian##bits* src, const field##bits* p) \
+    {                                                                                                 \
+        bn##bits zinv, zinv2;                                                                         \
+        if (bn##bits##_is_zero(&src->Z)) {                                                            \
+            bn##bits##_init(&dst->x);                                                                 \
+            bn##bits##_init(&dst->y);                                                                 \
+            dst->zero_flag = 1;                                                                       \
+            return;                                                                                   \
+        }                                                                                             \
+        field##bits##_reverse(&src->Z, &zinv, p);                                                     \
+        field##bits##_sqr(&zinv, &zinv2, p);                                                          \
+        field##bits##_mul(&src->X, &zinv2, &dst->x, p);         /* X / Z^2 */                         \
+        field##bits##_mul(&zinv2, &zinv, &zinv2, p);                                                  \
+        field##bits##_mul(&src->Y, &zinv2, &dst->y, p);         /* Y / Z^3 */                         \
+        dst->zero_flag = 0;                                                                           \
+    }                                                                                                 \
+                                                                                                      \
+    /* 2 (X, Y, Z). With a = -3 the slope numerator 3 X^2 + a Z^4 factors into                        \
+       3 (X - Z^2)(X + Z^2), a NULL a selects that form (dbl-2001-b). */                              \
+    void jacobian##bits##_double(const jacobian##bits* p1, jacobian##bits* p3, const bn##bits* a,     \
+                                 const field##bits* p)                                                \
+    {                                                                                                 \
+        bn##bits delta, gamma, beta, alpha, tmp, tmp2;                                                \
+        if (bn##bits##_is_zero(&p1->Z) || bn##bits##_is_zero(&p1->Y)) {                               \
+            bn##bits##_init(&p3->Z);                                                                  \
+            return;                                                                                   \
+        }                                                                                             \
+        field##bits##_sqr(&p1->Z, &delta, p);                   /* Z^2 */                             \
+        field##bits##_sqr(&p1->Y, &gamma, p);                   /* Y^2 */                             \
+        field##bits##_mul(&p1->X, &gamma, &beta, p);            /* X Y^2 */                           \
+        if (a == NULL) {                                                                              \
+            bn##bits##_sub_mod(&p1->X, &delta, &tmp, &p->mont.m);                                     \
+            bn##bits##_add_mod(&p1->X, &delta, &tmp2, &p->mont.m);                                    \
+            field##bits##_mul(&tmp, &tmp2, &alpha, p);          /* X^2 - Z^4 */                       \
+            bn##bits##_add_mod(&alpha, &alpha, &tmp, &p->mont.m);                                     \
+            bn##bits##_add_mod(&alpha, &tmp, &alpha, &p->mont.m); /* 3 (X^2 - Z^4) */                 \
+        } else {                                                                                      \
+            field##bits##_sqr(&p1->X, &alpha, p);                                                     \
+            bn##bits##_add_mod(&alpha, &alpha, &tmp, &p->mont.m);                                     \
+            bn##bits##_add_mod(&alpha, &tmp, &alpha, &p->mont.m); /* 3 X^2 */                         \
+            field##bits##_sqr(&delta, &tmp2, p);                                                      \
+            field##bits##_mul(&tmp2, a, &tmp2, p);                                                    \
+            bn##bits##_add_mod(&alpha, &tmp2, &alpha, &p->mont.m); /* 3 X^2 + a Z^4 */                \
+        }                                                                                             \
+        /* Z3 = (Y + Z)^2 - Y^2 - Z^2 = 2 Y Z, before X and Y are overwritten */                      \
+        bn##bits##_add_mod(&p1->Y, &p1->Z, &tmp, &p->mont.m);                                         \
+        field##bits##_sqr(&tmp, &tmp, p);                                                             \
+        bn##bits##_sub_mod(&tmp, &gamma, &tmp, &p->mont.m);                                           \
+        bn##bits##_sub_mod(&tmp, &delta, &p3->Z, &p->mont.m);                                         \
+        /* X3 = alpha^2 - 8 beta */                                                                   \
+        bn##bits##_add_mod(&beta, &beta, &beta, &p->mont.m);                                          \
+        bn##bits##_add_mod(&beta, &beta, &beta, &p->mont.m);    /* 4 beta */                          \
+        field##bits##_sqr(&alpha, &tmp, p);                                                           \
+        bn##bits##_sub_mod(&tmp, &beta, &tmp, &p->mont.m);                                            \
+        bn##bits##_sub_mod(&tmp, &beta, &p3->X, &p->mont.m);                                          \
+        /* Y3 = alpha (4 beta - X3) - 8 gamma^2 */                                                    \
+        bn##bits##_sub_mod(&beta, &p3->X, &tmp, &p->mont.m);                                          \
+        field##bits##_mul(&alpha, &tmp, &tmp, p);                                                     \
+        field##bits##_sqr(&gamma, &tmp2, p);                                                          \
+        bn##bits##_add_mod(&tmp2, &tmp2, &tmp2, &p->mont.m);                                          \
+        bn##bits##_add_mod(&tmp2, &tmp2, &tmp2, &p->mont.m);                                          \
+        bn##bits##_add_mod(&tmp2, &tmp2, &tmp2, &p->mont.m);    /* 8 gamma^2 */                       \
+        bn##bits##_sub_mod(&tmp, &tmp2, &p3->Y, &p->mont.m);                                          \
+    }                                                                                                 \
+                                                                                                      \
+    /* (X1, Y1, Z1) + (x2, y2), the affine operand has Z = 1 (madd-2004-hmv) */                       \
+    void jacobian##bits##_add_affine(const jacobian##bits* p1, const point##bits* p2,                 \
+                                     jacobian##bits* p3, const bn##bits* a, const field##bits* p)     \
+    {                                                                                                 \
+        bn##bits z1z1, u2, s2, h, r, hh, hhh, v, tmp;                                                 \
+        if (p2->zero_flag) {                                                                          \
+            *p3 = *p1;                                                                                \
+            return;                                                                                   \
+        }                                                                                             \
+        if (bn##bits##_is_zero(&p1->Z)) {                                                             \
+            point##bits##_to_jacobian(p3, p2, p);                                                     \
+            return;                                                                                   \
+        }                                                                                             \
+        field##bits##_sqr(&p1->Z, &z1z1, p);                                                          \
+        field##bits##_mul(&p2->x, &z1z1, &u2, p);               /* x2 Z1^2 */                         \
+        field##bits##_mul(&p1->Z, &z1z1, &s2, p);                                                     \
+        field##bits##_mul(&p2->y, &s2, &s2, p);                 /* y2 Z1^3 */                         \
+        bn##bits##_sub_mod(&u2, &p1->X, &h, &p->mont.m);                                              \
+        bn##bits##_sub_mod(&s2, &p1->Y, &r, &p->mont.m);                                              \
+        if (bn##bits##_is_zero(&h)) {                                                                 \
+            if (bn##bits##_is_zero(&r))                                                               \
+                jacobian##bits##_double(p1, p3, a, p);          /* the same point */                  \
+            else                                                                                      \
+                bn##bits##_init(&p3->Z);                        /* P + (-P) */                        \
+            return;                                                                                   \
+        }                                                                                             \
+        field##bits##_sqr(&h, &hh, p);                                                                \
+        field##bits##_mul(&h, &hh, &hhh, p);                                                          \
+        field##bits##_mul(&p1->X, &hh, &v, p);                                                        \
+        field##bits##_mul(&p1->Z, &h, &p3->Z, p);               /* Z3 = Z1 H */                       \
+        field##bits##_mul(&p1->Y, &hhh, &tmp, p);               /* Y1 H^3, before Y1 goes */          \
+        field##bits##_sqr(&r, &u2, p);                                                                \
+        bn##bits##_sub_mod(&u2, &hhh, &u2, &p->mont.m);                                               \
+        bn##bits##_sub_mod(&u2, &v, &u2, &p->mont.m);                                                 \
+        bn##bits##_sub_mod(&u2, &v, &p3->X, &p->mont.m);        /* X3 = r^2 - H^3 - 2 V */            \
+        bn##bits##_sub_mod(&v, &p3->X, &v, &p->mont.m);                                               \
+        field##bits##_mul(&r, &v, &v, p);                                                             \
+        bn##bits##_sub_mod(&v, &tmp, &p3->Y, &p->mont.m);       /* Y3 = r (V - X3) - Y1 H^3 */        \
+    }                                                                                                 \
+                                                                                                      \
+    /* NULL when a = -3 mod p, which picks the cheaper doubling */                                    \
+    static const bn##bits* curve_a_##bits(const bn##bits* a, const field##bits* p)                    \
+    {                                                                                                 \
+        bn##bits three, sum;                                                                          \
+        bn##bits##_add_mod(&p->one, &p->one, &three, &p->mont.m);                                     \
+        bn##bits##_add_mod(&three, &p->one, &three, &p->mont.m);                                      \
+        bn##bits##_add_mod(a, &three, &sum, &p->mont.m);                                              \
+        return bn##bits##_is_zero(&sum) ? NULL : a;                                                   \
+    }                                                                                                 \
+                                                                                                      \
+    /* Left to right double and add with a Jacobian accumulator, x stays                              \
+       affine for the mixed additions */                                                              \
+    void elliptic_mul_##bits(const point##bits* x, const bn##bits* k, const bn##bits* a,              \
+                             const field##bits* p, point##bits* result)                               \
+    {                                                                                                 \
+        jacobian##bits acc;                                                                           \
+        const bn##bits* a3 = curve_a_##bits(a, p);                                                    \
+        bn##bits##_init(&acc.Z);                                                                      \
+        for (int i = bn##bits##_bit_length(k) - 1; i >= 0; --i) {                                     \
+            jacobian##bits##_double(&acc, &acc, a3, p);                                               \
+            if (bn##bits##_bit(k, i))                                                                 \
+                jacobian##bits##_add_affine(&acc, x, &acc, a3, p);                                    \
+        }                                                                                             \
+        jacobian##bits##_to_point(result, &acc, p);                                                   \
+    }                                                                                                 \
+                                                                                                      \
+    /* Affine points from Jacobian ones kept as X, Y in pts and Z in z, with                          \
+       one batch inversion. Points at infinity carry zero_flag and a Z of 1. */                       \
+    static void normalize_##bits(point##bits* pts, const bn##bits* z, int n, const field##bits* p)    \
+    {                                                                                                 \
+        bn##bits zinv[CURVE_COMB_SIZE], zinv2;                                                        \
+        field##bits##_batch_reverse(z, zinv, n, p);                                                   \
+        for (int i = 0; i < n; ++i) {                                                                 \
+            if (pts[i].zero_flag)                                                                     \
+                continue;                                                                             \
+            field##bits##_sqr(&zinv[i], &zinv2, p);                                                   \
+            field##bits##_mul(&pts[i].x, &zinv2, &pts[i].x, p);                                       \
+            field##bits##_mul(&zinv2, &zinv[i], &zinv2, p);                                           \
+            field##bits##_mul(&pts[i].y, &zinv2, &pts[i].y, p);                                       \
+        }                                                                                             \
+    }                                                                                                 \
+                                                                                                      \
+    /* Lim-Lee comb: with t teeth s = ceil(nbits / t) bits apart, table[i - 1]                        \
+       is the sum of 2^(j s) P over the set bits j of i. k P reads k as t                             \
+       rows of s bits and costs s doublings and at most s mixed additions,                            \
+       one per column. The table is built in Jacobian coordinates and                                 \
+       brought to affine with a single batch inversion. */                                            \
+    void comb##bits##_init(comb##bits* c, const point##bits* P, int teeth, int nbits, const bn##bits* a, \
+                           const field##bits* p)                                                      \
+    {                                                                                                 \
+        bn##bits z[CURVE_COMB_SIZE];                                                                  \
+        jacobian##bits acc;                                                                           \
+        point##bits tooth[CURVE_COMB_MAX_TEETH];                                                      \
+        const bn##bits* a3 = curve_a_##bits(a, p);                                                    \
+        int size;                                                                                     \
+                                                                                                      \
+        if (teeth < 1)                                                                                \
+            teeth = 1;                                                                                \
+        if (teeth > CURVE_COMB_MAX_TEETH)                                                             \
+            teeth = CURVE_COMB_MAX_TEETH;                                                             \
+        size = (1 << teeth) - 1;                                                                      \
+        c->teeth = teeth;                                                                             \
+        c->spacing = (nbits + teeth - 1) / teeth;                                                     \
+                                                                                                      \
+        /* the teeth 2^(j s) P, normalized first as the additions below need them affine */           \
+        point##bits##_to_jacobian(&acc, P, p);                                                        \
+        for (int j = 0; j < teeth; ++j) {                                                             \
+            for (int i = 0; j > 0 && i < c->spacing; ++i)                                             \
+                jacobian##bits##_double(&acc, &acc, a3, p);                                           \
+            jacobian##bits##_to_point(&tooth[j], &acc, p);                                            \
+        }                                                                                             \
+                                                                                                      \
+        /* table[i - 1] = table[rest - 1] + tooth[top], X and Y in the table, Z aside */              \
+        for (int i = 1; i <= size; ++i) {                                                             \
+            int top = 0;                                                                              \
+            while (i >> (top + 1))                                                                    \
+                ++top;                                                                                \
+            int rest = i & ~(1 << top);                                                               \
+            if (rest == 0) {                                                                          \
+                point##bits##_to_jacobian(&acc, &tooth[top], p);                                      \
+            } else {                                                                                  \
+                acc.X = c->table[rest - 1].x;                                                         \
+                acc.Y = c->table[rest - 1].y;                                                         \
+                acc.Z = z[rest - 1];                                                                  \
+                jacobian##bits##_add_affine(&acc, &tooth[top], &acc, a3, p);                          \
+            }                                                                                         \
+            c->table[i - 1].x = acc.X;                                                                \
+            c->table[i - 1].y = acc.Y;                                                                \
+            c->table[i - 1].zero_flag = bn##bits##_is_zero(&acc.Z);                                   \
+            z[i - 1] = c->table[i - 1].zero_flag ? p->one : acc.Z;                                    \
+        }                                                                                             \
+                                                                                                      \
+        normalize_##bits(c->table, z, size, p);                                                       \
+    }                                                                                                 \
+                                                                                                      \
+    /* k P for the P of the table, k below 2^(teeth spacing); a longer k                              \
+       takes the generic path */                                                                      \
+    void comb##bits##_mul(const comb##bits* c, const bn##bits* k, const bn##bits* a,                  \
+                          const field##bits* p, point##bits* result)                                  \
+    {                                                                                                 \
+        jacobian##bits acc;                                                                           \
+        const bn##bits* a3 = curve_a_##bits(a, p);                                                    \
+        if (bn##bits##_bit_length(k) > c->teeth * c->spacing) {                                       \
+            elliptic_mul_##bits(&c->table[0], k, a, p, result);                                       \
+            return;                                                                                   \
+        }                                                                                             \
+        bn##bits##_init(&acc.Z);                                                                      \
+        for (int i = c->spacing - 1; i >= 0; --i) {                                                   \
+            int index = 0;                                                                            \
+            jacobian##bits##_double(&acc, &acc, a3, p);                                               \
+            for (int j = c->teeth - 1; j >= 0; --j) {                                                 \
+                int bit = i + j * c->spacing;                                                         \
+                index = (index << 1) | (bit < bits && bn##bits##_bit(k, bit));                        \
+            }                                                                                         \
+            if (index)                                                                                \
+                jacobian##bits##_add_affine(&acc, &c->table[index - 1], &acc, a3, p);                 \
+        }                                                                                             \
+        jacobian##bits##_to_point(result, &acc, p);                                                   \
+    }                                                                                                 \
+                                                                                                      \
+    /* u1 G + u2 Q over one chain of doublings, G from its comb and Q a                               \
+       variable point. u2 enters as its width CURVE_WNAF_WIDTH NAF over the                           \
+       odd multiples Q, 3 Q, ... normalized up front, the comb columns of u1                          \
+       join over the last spacing steps of the chain. */                                              \
+    void elliptic_mul_add_##bits(const comb##bits* c, const bn##bits* u1, const point##bits* Q,       \
+                                 const bn##bits* u2, const bn##bits* a, const field##bits* p,         \
+                                 point##bits* result)                                                 \
+    {                                                                                                 \
+        int8_t naf[bits + 1];                                                                         \
+        point##bits odd[CURVE_WNAF_SIZE], twice, neg;                                                 \
+        bn##bits z[CURVE_WNAF_SIZE];                                                                  \
+        jacobian##bits acc;                                                                           \
+        const bn##bits* a3 = curve_a_##bits(a, p);                                                    \
+        int len, top;                                                                                 \
+                                                                                                      \
+        if (Q->zero_flag || bn##bits##_bit_length(u1) > c->teeth * c->spacing) {                      \
+            point##bits uG, uQ;                                                                       \
+            comb##bits##_mul(c, u1, a, p, &uG);                                                       \
+            elliptic_mul_##bits(Q, u2, a, p, &uQ);                                                    \
+            elliptic_add_##bits(&uG, &uQ, result, a, p);                                              \
+            return;                                                                                   \
+        }                                                                                             \
+                                                                                                      \
+        /* odd[i] = (2 i + 1) Q */                                                                    \
+        elliptic_add_##bits(Q, Q, &twice, a, p);                                                      \
+        point##bits##_to_jacobian(&acc, Q, p);                                                        \
+        for (int i = 0; i < CURVE_WNAF_SIZE; ++i) {                                                   \
+            if (i > 0)                                                                                \
+                jacobian##bits##_add_affine(&acc, &twice, &acc, a3, p);                               \
+            odd[i].x = acc.X;                                                                         \
+            odd[i].y = acc.Y;                                                                         \
+            odd[i].zero_flag = bn##bits##_is_zero(&acc.Z);                                            \
+            z[i] = odd[i].zero_flag ? p->one : acc.Z;                                                 \
+        }                                                                                             \
+        normalize_##bits(odd, z, CURVE_WNAF_SIZE, p);                                                 \
+                                                                                                      \
+        len = wnaf_digits(u2->array, BN_WORDS(bits), CURVE_WNAF_WIDTH, naf);                          \
+        top = len > c->spacing ? len : c->spacing;                                                    \
+        bn##bits##_init(&acc.Z);                                                                      \
+        for (int i = top - 1; i >= 0; --i) {                                                          \
+            jacobian##bits##_double(&acc, &acc, a3, p);                                               \
+            if (i < len && naf[i] > 0) {                                                              \
+                jacobian##bits##_add_affine(&acc, &odd[naf[i] >> 1], &acc, a3, p);                    \
+            } else if (i < len && naf[i] < 0) {                                                       \
+                neg = odd[-naf[i] >> 1];                                                              \
+                bn##bits##_negate(&neg.y, &p->mont.m);                                                \
+                jacobian##bits##_add_affine(&acc, &neg, &acc, a3, p);                                 \
+            }                                                                                         \
+            if (i < c->spacing) {                                                                     \
+                int index = 0;                                                                        \
+                for (int j = c->teeth - 1; j >= 0; --j) {                                             \
+                    int bit = i + j * c->spacing;                                                     \
+                    index = (index << 1) | (bit < bits && bn##bits##_bit(u1, bit));                   \
+                }                                                                                     \
+                if (index)                                                                            \
+                    jacobian##bits##_add_affine(&acc, &c->table[index - 1], &acc, a3, p);             \
+            }                                                                                         \
+        }                                                                                             \
+        jacobian##bits##_to_point(result, &acc, p);                                                   \
+    }
+
+CURVE_DEFINE_WIDTH(192)
+CURVE_DEFINE_WIDTH(224)
+CURVE_DEFINE_WIDTH(256)
+CURVE_DEFINE_WIDTH(384)
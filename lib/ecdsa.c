@@ -5,111 +5,156 @@
 
 extern curve p_192;
 
-void bignum_gen_mod(bignum* k, bignum* n, uint32_t (*rand_func) (void));
-
 //y^2 ≡ x^3 – 3x + b (mod p) //a = -3
 
-void ecdsa_public_key(bignum *da, curve *ellip, point *ha) {
-
-    bignum_curve_t ellip_curve;
-    ellip_curve_init(&ellip_curve, ellip);
-    point G;
-    G.zero_flag = 0;
-    bignum_copy(&G.x, &ellip_curve.Gx);
-    bignum_copy(&G.y, &ellip_curve.Gy);
-
-    bignum a;
-    bignum_from_int(&a, 3);
-    bignum_negate(&a, &ellip_curve.p); // a = -3 mod p
+int ecdsa_comb_teeth = 5;
+
+/* Every curve runs on the narrowest bn<bits> family that holds p: the
+   public entry points convert the operands once and hand over to the
+   width-specialized code below, with the curve parsed in advance by
+   ecdsa_curve_init(). */
+#define ECDSA_DEFINE_WIDTH(bits)                                                                      \
+    static void ecdsa_curve_init_##bits(ecdsa_curve* ec, curve* ellip)                                \
+    {                                                                                                 \
+        struct ecdsa_curve_##bits* c = &ec->c##bits;                                                  \
+        bignum_curve_t ellip_curve;                                                                   \
+        bn##bits m;                                                                                   \
+        ellip_curve_init(&ellip_curve, ellip);                                                        \
+        bn##bits##_from_bignum(&m, &ellip_curve.p);                                                   \
+        field##bits##_init(&c->p, &m);                                                                \
+        bn##bits##_from_bignum(&m, &ellip_curve.n);                                                   \
+        bn##bits##_barrett_init(&c->n, &m);                                                           \
+        bn##bits##_from_bignum(&c->G.x, &ellip_curve.Gx);                                             \
+        bn##bits##_from_bignum(&c->G.y, &ellip_curve.Gy);                                             \
+        c->G.zero_flag = 0;                                                                           \
+        point##bits##_encode(&c->G, &c->G, &c->p);                                                    \
+        bn##bits##_from_int(&c->a, 3);                                                                \
+        bn##bits##_negate(&c->a, &c->p.mont.m); /* a = -3 mod p */                                    \
+        field##bits##_encode(&c->a, &c->a, &c->p);                                                    \
+        comb##bits##_init(&c->G_comb, &c->G, ecdsa_comb_teeth, bn##bits##_bit_length(&c->n.m),        \
+                          &c->a, &c->p);                                                              \
+    }                                                                                                 \
+                                                                                                      \
+    /* c = a mod m for an a of the same width */                                                      \
+    static void ecdsa_reduce_##bits(const bn##bits* a, const bn##bits##_barrett* m, bn##bits* c)      \
+    {                                                                                                 \
+        bn##bits##w wide;                                                                             \
+        bn##bits##_widen(a, &wide);                                                                   \
+        bn##bits##_barrett_reduce(&wide, m, c);                                                       \
+    }                                                                                                 \
+                                                                                                      \
+    static void ecdsa_public_key_##bits(bignum* da, const ecdsa_curve* ec, point* ha)                 \
+    {                                                                                                 \
+        const struct ecdsa_curve_##bits* c = &ec->c##bits;                                            \
+        bn##bits d;                                                                                   \
+        point##bits H;                                                                                \
+        bn##bits##_from_bignum(&d, da);                                                               \
+        comb##bits##_mul(&c->G_comb, &d, &c->a, &c->p, &H);                                           \
+        point##bits##_decode(&H, &H, &c->p);                                                          \
+        point##bits##_to_point(ha, &H);                                                               \
+    }                                                                                                 \
+                                                                                                      \
+    static void ecdsa_sign_##bits(const ecdsa_curve* ec, bignum* z, bignum* da, bignum* r, bignum* s) \
+    {                                                                                                 \
+        const struct ecdsa_curve_##bits* c = &ec->c##bits;                                            \
+        bn##bits##w wide;                                                                             \
+        bn##bits zn, d, k, rn, sn, tmp, tmp2;                                                         \
+        point##bits P;                                                                                \
+        bn##bits##_from_bignum(&zn, z);                                                               \
+        ecdsa_reduce_##bits(&zn, &c->n, &zn);                                                         \
+        bn##bits##_from_bignum(&d, da);                                                               \
+        do {                                                                                          \
+            /* twice the width, so the reduction leaves no visible bias */                            \
+            crng_fill_rdrand(wide.array, sizeof(wide.array));                                         \
+            bn##bits##_barrett_reduce(&wide, &c->n, &k);                                              \
+                                                                                                      \
+            comb##bits##_mul(&c->G_comb, &k, &c->a, &c->p, &P);  /* P = kG */                         \
+            field##bits##_decode(&P.x, &P.x, &c->p);                                                  \
+            ecdsa_reduce_##bits(&P.x, &c->n, &rn);             /* r = Px mod n */                     \
+                                                                                                      \
+            bn##bits##_mul_mod(&rn, &d, &tmp, &c->n);          /* r * da mod n */                     \
+            bn##bits##_add_mod(&zn, &tmp, &tmp2, &c->n.m);     /* z + r * da mod n */                 \
+            bn##bits##_reverse(&tmp, &k, &c->n.m);             /* k ^ -1 mod n */                     \
+            bn##bits##_mul_mod(&tmp, &tmp2, &sn, &c->n);       /* k ^ -1 * (z + r * da) mod n */      \
+        } while (bn##bits##_is_zero(&rn) || bn##bits##_is_zero(&sn));                                 \
+        bn##bits##_to_bignum(r, &rn);                                                                 \
+        bn##bits##_to_bignum(s, &sn);                                                                 \
+    }                                                                                                 \
+                                                                                                      \
+    static int ecdsa_verify_##bits(bignum* z, bignum* r, bignum* s, const ecdsa_curve* ec, point* ha) \
+    {                                                                                                 \
+        const struct ecdsa_curve_##bits* c = &ec->c##bits;                                            \
+        bn##bits zn, rn, sn, u1, u2, rev_s, tmp;                                                      \
+        point##bits H, P;                                                                             \
+        /* 1 <= r, s < n, tested on the bignums before from_bignum() drops high words */              \
+        if (bignum_bit_length(r) > bits || bignum_bit_length(s) > bits) {                             \
+            return 0;                                                                                 \
+        }                                                                                             \
+        bn##bits##_from_bignum(&rn, r);                                                               \
+        bn##bits##_from_bignum(&sn, s);                                                               \
+        if (bn##bits##_is_zero(&rn) || bn##bits##_cmp(&rn, &c->n.m) != SMALLER ||                     \
+            bn##bits##_is_zero(&sn) || bn##bits##_cmp(&sn, &c->n.m) != SMALLER) {                     \
+            return 0;                                                                                 \
+        }                                                                                             \
+        bn##bits##_from_bignum(&zn, z);                                                               \
+        point##bits##_from_point(&H, ha);                                                             \
+        point##bits##_encode(&H, &H, &c->p);                                                          \
+        ecdsa_reduce_##bits(&zn, &c->n, &zn);                                                         \
+                                                                                                      \
+        bn##bits##_reverse(&rev_s, &sn, &c->n.m);              /* s ^ -1 */                           \
+        bn##bits##_mul_mod(&rev_s, &zn, &u1, &c->n);           /* u1 = s ^ -1 * z mod n */            \
+        bn##bits##_mul_mod(&rev_s, &rn, &u2, &c->n);           /* u2 = s ^ -1 * r mod n */            \
+                                                                                                      \
+        /* P = u1 * G + u2 * HA, one chain of doublings */                                            \
+        elliptic_mul_add_##bits(&c->G_comb, &u1, &H, &u2, &c->a, &c->p, &P);                          \
+        if (P.zero_flag) {                                                                            \
+            return 0;                                                                                 \
+        }                                                                                             \
+                                                                                                      \
+        field##bits##_decode(&P.x, &P.x, &c->p);                                                      \
+        ecdsa_reduce_##bits(&P.x, &c->n, &tmp);                                                       \
+        return bn##bits##_cmp(&rn, &tmp) == EQUAL;                                                    \
+    }
+
+ECDSA_DEFINE_WIDTH(192)
+ECDSA_DEFINE_WIDTH(224)
+ECDSA_DEFINE_WIDTH(256)
+ECDSA_DEFINE_WIDTH(384)
+
+#define ECDSA_DISPATCH(bits_, func, ...)             \
+    switch (bits_) {                                 \
+    case 224: return func##_224(__VA_ARGS__);        \
+    case 256: return func##_256(__VA_ARGS__);        \
+    case 384: return func##_384(__VA_ARGS__);        \
+    default:  return func##_192(__VA_ARGS__);        \
+    }
+
+/* Slow: parses the curve strings with bignum_from_str(), once per curve */
+void ecdsa_curve_init(ecdsa_curve *ec, curve *ellip) {
+    ec->bits = ellip->bits;
+    ECDSA_DISPATCH(ellip->bits, ecdsa_curve_init, ec, ellip);
+}
 
-    elliptic_mul(&G, da, &a, &ellip_curve.p, ha);
+void ecdsa_public_key(bignum *da, const ecdsa_curve *ec, point *ha) {
+    ECDSA_DISPATCH(ec->bits, ecdsa_public_key, da, ec, ha);
 }
 
 void ecdsa_sign(
-        curve *ellip, // curve, IN
+        const ecdsa_curve *ec, // curve, IN
         bignum *z, // hash, IN
         bignum *da, // private key, IN
         bignum *r, // r, OUT
         bignum *s // s, OUT
 ) {
-    bignum k;
-    bignum zero;
-    bignum_from_int(&zero, 0);
-
-    bignum_curve_t ellip_curve;
-    ellip_curve_init(&ellip_curve, ellip);
-    bignum_mod(z, &ellip_curve.n, z);
-
-    bignum a;
-    bignum_from_int(&a, 3);
-    bignum_negate(&a, &ellip_curve.p); // a = -3 mod p
-    point P, G;
-    G.zero_flag = 0;
-    bignum_copy(&G.x, &ellip_curve.Gx);
-    bignum_copy(&G.y, &ellip_curve.Gy);
-
-kgen:
-    bignum_gen_mod(&k, &ellip_curve.n, secure_urand32_rdrand);
-
-    elliptic_mul(&G, &k, &a, &ellip_curve.p, &P); // P = kG
-    bignum_mod(&P.x, &ellip_curve.n, r); // r = Px mod n
-
-    bignum tmp, tmp2;
-    bignum_mul_mod(r, da, &tmp, &ellip_curve.n); // r * da mod n
-    bignum_add_mod(z, &tmp, &tmp2, &ellip_curve.n); // z + r * da mod n
-    bignum_reverse(&tmp, &k, &ellip_curve.n); // k ^ -1 mod n
-
-    bignum_mul_mod(&tmp, &tmp2, s, &ellip_curve.n); // k ^ -1 *  (z + r * da) mod n
-
-    if (bignum_cmp(r, &zero) == EQUAL || bignum_cmp(s, &zero) == EQUAL)
-        goto kgen;
+    ECDSA_DISPATCH(ec->bits, ecdsa_sign, ec, z, da, r, s);
 }
 
 int ecdsa_verify(
         bignum *z, // z, IN
         bignum *r, // r, IN
         bignum *s, // s, IN
-        curve *ellip, // curve, IN
+        const ecdsa_curve *ec, // curve, IN
         point *ha // HA, IN
 ) {
-    bignum u1, u2, rev_s;
-
-    bignum_curve_t ellip_curve;
-    ellip_curve_init(&ellip_curve, ellip);
-
-    point G;
-    G.zero_flag = 0;
-    bignum_copy(&G.x, &ellip_curve.Gx);
-    bignum_copy(&G.y, &ellip_curve.Gy);
-
-    bignum a;
-    bignum_from_int(&a, 3);
-    bignum_negate(&a, &ellip_curve.p); // a = -3 mod p
-
-    bignum_reverse(&rev_s, s, &ellip_curve.n); // s ^ -1
-    bignum_mul_mod(&rev_s, z, &u1, &ellip_curve.n); // u1 = s ^ -1 * z mod n
-    bignum_mul_mod(&rev_s, r, &u2, &ellip_curve.n); // u2 = s ^ -1 * r mod n
-
-    point P, uG, uH;
-    elliptic_mul(&G, &u1, &a, &ellip_curve.p, &uG); // u1 * G
-    elliptic_mul(ha, &u2, &a, &ellip_curve.p, &uH); // u2 * HA
-    elliptic_add(&uG, &uH, &P, &a, &ellip_curve.p); // P = u1 * G + u2 * HA
-
-    bignum tmp;
-    bignum_mod(&P.x, &ellip_curve.p, &tmp);
-
-    return bignum_cmp(r, &tmp) == EQUAL;
+    ECDSA_DISPATCH(ec->bits, ecdsa_verify, z, r, s, ec, ha);
 }
-
-void bignum_gen_mod(bignum* k, bignum *n, uint32_t (*rand_func) (void))
-{
-    for (int i = 0; i < BN_ARRAY_SIZE; ++i)
-        k->array[i] = rand_func();
-    bignum temp;
-    bignum_copy(&temp, k);
-    bignum_mod(&temp, n, k);
-}
-
-
-
-
@@ -0,0 +1,39 @@
+/* Random bytes from the kernel entropy pool.
+ *
+ * Small requests are served from a per-environment buffer that a single
+ * SYS_getrandom refills, so most calls do not trap. The buffer is tagged
+ * with the owning env_id: after fork() the child must not hand out the
+ * bytes its parent still has buffered. */
+
+#include <inc/string.h>
+#include <inc/lib.h>
+
+#define GETRANDOM_BUF_SIZE 256
+
+static uint8_t random_buf[GETRANDOM_BUF_SIZE];
+static size_t random_pos = GETRANDOM_BUF_SIZE;
+static envid_t random_owner;
+
+int
+getrandom(void *buf, size_t len) {
+    /* Large requests would drain the buffer anyway */
+    if (len > GETRANDOM_BUF_SIZE / 2)
+        return sys_getrandom(buf, len);
+
+    if (random_owner != thisenv->env_id) {
+        random_owner = thisenv->env_id;
+        random_pos = GETRANDOM_BUF_SIZE;
+    }
+
+    if (GETRANDOM_BUF_SIZE - random_pos < len) {
+        int res = sys_getrandom(random_buf, GETRANDOM_BUF_SIZE);
+        if (res < 0) return res;
+        random_pos = 0;
+    }
+
+    memcpy(buf, random_buf + random_pos, len);
+    /* Handed out bytes must not stay around */
+    memset(random_buf + random_pos, 0, len);
+    random_pos += len;
+    return len;
+}
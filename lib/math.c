@@ -7,50 +7,30 @@ void abs_func(double x, double *res) {
     *res = (x > 0) ? x : -x;
 }
 
-//log(1 + x) ~= x - x^2/2 + x^3/3 - x^4/4
+//fyl2xp1 keeps full precision for small eps where log(1 + eps) would lose it
 void log_1_eps_func(double eps, double *res) {
-    double x = eps;
-    double x2 = x * x;
-    double x3 = x2 * x;
-    double x4 = x2 * x2;
-    *res = x - x2 / 2 + x3 / 3 - x4 / 4;
+    if (eps <= -0.29 || eps >= 0.29) { //outside the range of fyl2xp1
+        log_func(1 + eps, res);
+        return;
+    }
+    double ret;
+    asm("fldln2; fxch; fyl2xp1" : "=t"(ret) : "0"(eps));
+    *res = ret;
 }
 
+//The x87 unit computes log2 to full double precision, the statistics of
+//the universal and entropy tests sum many logs and need all of it
 void log2_func(double x, double *res) {
     // x>0
-    static _Bool first = 1;
-#define precision 12
-#define size (1 << precision)
-    static double log_table[size];
-    static double const c_log2 = 1.442695040888963407359924681;
-    if (first) {
-        //for example: log(1 + 2/4096) = log((4097/4096) * (4098/4097)) = log(1 + 1/4096) + log(1 + 1/4097);
-        // log(1 + k/size) = pred_log + log(1 + 1/(size + k - 1));  | pred_log = log(1 + (k-1)/size);
-        log_table[0] = 0;
-        double pred_log = log_table[0];
-        for (int k = 1; k < size; k++) { //k_1 = k - 1
-            double eps = 1 / ((double)k + size);
-            double log_1;
-            log_1_eps_func(eps, &log_1);
-            pred_log = pred_log + log_1;
-            log_table[k] = pred_log * c_log2;
-        }
-        first = 0;
-    }
-
-    uint64_t t = *(uint64_t *)&x;
-    int exp = (t >> 52) - 0x3ff;
-    int mantissa = (t >> (52 - precision)) & (size - 1);
-    *res = exp + log_table[mantissa];
-#undef size
-#undef precision
+    double ret;
+    asm("fld1; fxch; fyl2x" : "=t"(ret) : "0"(x));
+    *res = ret;
 }
 
 void log_func(double x, double *res) {
-    static double const c_log = 0.6931471805599453;
-    double log2;
-    log2_func(x, &log2);
-    *res = c_log * log2;
+    double ret;
+    asm("fldln2; fxch; fyl2x" : "=t"(ret) : "0"(x));
+    *res = ret;
 }
 
 void exp_eps_func(double eps, double *res) {
@@ -87,137 +67,206 @@ void exp_n_func(int32_t n, double *res) {
     *res = power;
 }
 
+//e^st = 2^n * 2^f, n = round(st * log2(e)), |f| <= 1/2
 void exp_func(double st, double *res) {
-    _Bool less_zero = (st < 0);
-    if (less_zero)st = -st;
-
-    int32_t entire_to = (int32_t)st;
-    double eps = st - entire_to;
-    //exp(n + eps) = exp(n)*exp(eps)
-    double entire_exp;
-    exp_n_func(entire_to, &entire_exp);
-    double eps_exp;
-    exp_eps_func(eps, &eps_exp);
-
-    double ret = entire_exp * eps_exp;
+    double ret;
+    asm("fldl2e; fmulp; fld %%st(0); frndint; fxch; fsub %%st(1), %%st; f2xm1; fld1; faddp; fscale; fstp %%st(1)"
+        : "=t"(ret) : "0"(st));
+    *res = ret;
+}
 
-    *res = (less_zero) ? (1.0 / ret) : ret;
+void sincos_func(double x, double *sin, double *cos) {
+    double s, c;
+    asm("fsincos" : "=t"(c), "=u"(s) : "0"(x));
+    *sin = s;
+    *cos = c;
 }
 
+//x >= 0. Everything is built with -mno-sse, so doubles live on the x87
+//stack and the compiler has no XMM register to give sqrtsd: fsqrt takes
+//the value where it already is
 void sqrt_func(double x, double *res) {
-    if (x < 0)
-        *res = x;
-    if (x == 1.0 || x == 0.0)
-        *res = x;
-
-    double from = 0;
-    double to = x;
-    double ret = 0;
-    _Bool less = (x <= 1);
-    if (less) {
-        ret = x + (1 - x) / 2;
-        from = x;
-        to = 1;
-    } else {
-        ret = 1.0 + (x - 1) / 2;
-        from = 1;
-    }
+    double ret;
+    asm("fsqrt" : "=t"(ret) : "0"(x));
+    *res = ret;
+}
 
-    const int enough = 32;
+//Cephes rational approximations: x * T(x^2) / U(x^2) for erf on |x| < 1,
+//exp(-x^2) P(x) / Q(x) for erfc on 1 <= x < 8 and exp(-x^2) R(x) / S(x) past it
+static const double erf_T[] = {
+        9.60497373987051638749E0, 9.00260197203842689217E1, 2.23200534594684319226E3,
+        7.00332514112805075473E3, 5.55923013010394962768E4};
+static const double erf_U[] = {
+        1.00000000000000000000E0, 3.35617141647503099647E1, 5.21357949780152679795E2,
+        4.59432382970980127987E3, 2.26290000613890934246E4, 4.92673942608635921086E4};
+static const double erfc_P[] = {
+        2.46196981473530512524E-10, 5.64189564831068821977E-1, 7.46321056442269912687E0,
+        4.86371970985681366614E1, 1.96520832956077098242E2, 5.26445194995477358631E2,
+        9.34528527171957607540E2, 1.02755188689515710272E3, 5.57535335369399327526E2};
+static const double erfc_Q[] = {
+        1.00000000000000000000E0, 1.32281951154744992508E1, 8.67072140885989742329E1,
+        3.54937778887819891062E2, 9.75708501743205489753E2, 1.82390916687909736289E3,
+        2.24633760818710981792E3, 1.65666309194161350182E3, 5.57535340817727675546E2};
+static const double erfc_R[] = {
+        5.64189583547755073984E-1, 1.27536670759978104416E0, 5.01905042251180477414E0,
+        6.16021097993053585195E0, 7.40974269950448939160E0, 2.97886665372100240670E0};
+static const double erfc_S[] = {
+        1.00000000000000000000E0, 2.26052863220117276590E0, 9.39603524938001434673E0,
+        1.20489539808096656605E1, 1.70814450747565897222E1, 9.60896809063285878198E0,
+        3.36907645100081516050E0};
 
-    for (int k = 0; k < enough; k++) {
-        double z = ret * ret;
-        if (z == x) break;
-        if (z < x) from = ret;
-        else to = ret;
-        ret = (from + to) / 2;
+//Horner scheme, coef[0] is the highest power
+static void polynomial_func(double x, const double *coef, int degree, double *res) {
+    double ret = coef[0];
+    for (int i = 1; i <= degree; i++) {
+        ret = ret * x + coef[i];
     }
     *res = ret;
 }
 
-void integral_func(double from, double to, double eps, ptr_integral_func func, int param_count, const double *const_params, double *res) {
-    if (!func)
-        *res = 0;
-    if (eps == 0)eps = 1E-5;// 1E-6;
-    _Bool sg = 0;
-    if (from > to) {
-        double temp = to;
-        to = from;
-        from = temp;
-        sg = 1;
+void erf_func(double x, double *res) {
+    double abs_x, p, q;
+    abs_func(x, &abs_x);
+    if (abs_x >= 1.0) {
+        erfc_func(x, &p);
+        *res = 1.0 - p;
+        return;
     }
+    polynomial_func(x * x, erf_T, 4, &p);
+    polynomial_func(x * x, erf_U, 5, &q);
+    *res = x * p / q;
+}
 
-    double I = 0;
-    double I_back = 0;
-
-    uint64_t n = 16;
-    double delta = to - from;
-    double func_in_from, func_in_to;
-    func(from, param_count, const_params, &func_in_from);
-    func(to, param_count, const_params, &func_in_to);
-
-    uint32_t max_do = 20;
-
-    do {
-        max_do--;
-        n *= 2;
-        I_back = I;
-        I = 0;
-        double delta_n = delta / n;
-        double delta_n_2 = delta / (2 * n);
-        double f_i_1 = func_in_from;//f(x[i-1])
-        for (uint64_t i = 1; i < n; i++) {
-            double x_i = from + i * delta_n;
-            double f_i;
-            func(x_i, param_count, const_params, &f_i);
-            I += (f_i + f_i_1) * delta_n_2;
-            f_i_1 = f_i;
-        }
-        I += (func_in_to - f_i_1) * delta_n_2;
-    } while (((I - I_back) > eps) && (max_do != 0));
-    *res = sg ? -I : I;
+void erfc_func(double x, double *res) {
+    double abs_x, p, q, e;
+    abs_func(x, &abs_x);
+    if (abs_x < 1.0) {
+        erf_func(x, &p);
+        *res = 1.0 - p;
+        return;
+    }
+    if (abs_x * abs_x > 709.78) { //exp(-x^2) underflows
+        *res = x < 0 ? 2.0 : 0.0;
+        return;
+    }
+    exp_func(-abs_x * abs_x, &e);
+    if (abs_x < 8.0) {
+        polynomial_func(abs_x, erfc_P, 8, &p);
+        polynomial_func(abs_x, erfc_Q, 8, &q);
+    } else {
+        polynomial_func(abs_x, erfc_R, 5, &p);
+        polynomial_func(abs_x, erfc_S, 6, &q);
+    }
+    *res = x < 0 ? 2.0 - e * p / q : e * p / q;
 }
 
-void gamma_def(double x, int len, const double *a_ptr, double *res) {
-    if (len < 1)
-        *res = 0;
-    double a = a_ptr[0];
-    double log_x;
-    log_func(x, &log_x);
-    double st = log_x * (a - 1) - x;
-    if (st < -20)
-        *res = 0;
-    exp_func(st, res);
+//Lanczos approximation, g = 7, x >= 1/2
+void log_gamma_func(double x, double *res) {
+    static const double lanczos[] = {
+            0.99999999999980993, 676.5203681218851, -1259.1392167224028,
+            771.32342877765313, -176.61502916214059, 12.507343278686905,
+            -0.13857109526572012, 9.9843695780195716e-6, 1.5056327351493116e-7};
+    x -= 1;
+    double sum = lanczos[0];
+    for (int i = 1; i < sizeof(lanczos) / sizeof(lanczos[0]); i++) {
+        sum += lanczos[i] / (x + i);
+    }
+    double t = x + 7.5, log_t, log_sum;
+    log_func(t, &log_t);
+    log_func(sum, &log_sum);
+    *res = 0.91893853320467274178 + (x + 0.5) * log_t - t + log_sum; //log(sqrt(2pi))
 }
 
-void gamma_func(double a, double z, double *res) {
-    double from = z, to = 5 + a * 5;
-    if (-1.0 < from && from < 0.0)
-        from = 0.0;
-    if (from > to)
+#define igam_eps      1.11022302462515654042E-16
+#define igam_big      4.503599627370496e15
+#define igam_big_inv  2.22044604925031308085e-16
+#define igam_max_iter 100000
+
+//x^a e^-x / Gamma(a), zero if it underflows.
+//For large a near x the exponent is a difference of huge terms, Stirling's
+//series turns it into a (log(1 + t) - t) + log(a) / 2 - log(2 pi) / 2 - R(a),
+//t = (x - a) / a, which keeps its precision.
+static void igam_factor(double a, double x, double *res) {
+    double st;
+    if (a >= 20 && x > 0.75 * a && x < 1.25 * a) {
+        double t = (x - a) / a, log_t, log_a, a_2 = a * a;
+        log_1_eps_func(t, &log_t);
+        log_func(a, &log_a);
+        double R = (1. / 12 - (1. / 360 - (1. / 1260 - 1. / (1680 * a_2)) / a_2) / a_2) / a;
+        st = a * (log_t - t) + log_a / 2 - 0.91893853320467274178 - R;
+    } else {
+        double log_x, log_gamma;
+        log_func(x, &log_x);
+        log_gamma_func(a, &log_gamma);
+        st = a * log_x - x - log_gamma;
+    }
+    if (st < -709.78) {
         *res = 0;
-    integral_func(from, to, 0, gamma_def, 1, &a, res);
+        return;
+    }
+    exp_func(st, res);
 }
 
-void erf_def(double x, int not_used, const double *no_used, double *res) {
-    if (x > 6)
-        *res = 0.0;
-    exp_func(-(x * x), res);
+//Power series for the lower function P(a, x), converges fast for x < a + 1
+static void igam_series(double a, double x, double *res) {
+    double factor;
+    igam_factor(a, x, &factor);
+    double r = a, c = 1, sum = 1;
+    for (int i = 0; i < igam_max_iter && c > sum * igam_eps; i++) {
+        r += 1;
+        c *= x / r;
+        sum += c;
+    }
+    *res = sum * factor / a;
 }
 
-void erf_func(double x, double *res) {
-    if (x > 3.5)
-        *res = 1.0;
-    double loc_res;
-    integral_func(0, x, 0, erf_def, 0, NULL, &loc_res);
-    double ret = 1.1283791670955125738961589 * loc_res;
-    if (ret > 1.0)
-        ret = 1.0;
-    *res = ret;
+//Continued fraction for the upper function Q(a, x), x >= a + 1
+static void igamc_fraction(double a, double x, double *res) {
+    double factor;
+    igam_factor(a, x, &factor);
+    double y = 1 - a, z = x + y + 1, c = 0;
+    double pkm2 = 1, qkm2 = x, pkm1 = x + 1, qkm1 = z * x;
+    double ans = pkm1 / qkm1, t;
+    int i = 0;
+    do {
+        c += 1;
+        y += 1;
+        z += 2;
+        double yc = y * c;
+        double pk = pkm1 * z - pkm2 * yc;
+        double qk = qkm1 * z - qkm2 * yc;
+        if (qk != 0) {
+            double r = pk / qk;
+            abs_func((ans - r) / r, &t);
+            ans = r;
+        } else {
+            t = 1;
+        }
+        pkm2 = pkm1;
+        pkm1 = pk;
+        qkm2 = qkm1;
+        qkm1 = qk;
+        abs_func(pk, &pk);
+        if (pk > igam_big) {
+            pkm2 *= igam_big_inv;
+            pkm1 *= igam_big_inv;
+            qkm2 *= igam_big_inv;
+            qkm1 *= igam_big_inv;
+        }
+    } while (t > igam_eps && ++i < igam_max_iter);
+    *res = ans * factor;
 }
 
-void erfc_func(double x, double *res) {
-    double loc_res;
-    erf_func(x, &loc_res);
-    *res = 1.0 - loc_res;
+void igamc_func(double a, double x, double *res) {
+    if (x <= 0 || a <= 0) {
+        *res = 1;
+        return;
+    }
+    if (x < 1 || x < a) {
+        double lower;
+        igam_series(a, x, &lower);
+        *res = 1 - lower;
+        return;
+    }
+    igamc_fraction(a, x, res);
 }
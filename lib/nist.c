@@ -2,87 +2,332 @@
 // Created by daniil on 20.12.2021.
 //
 #include <inc/nist.h>
+#include <inc/x86.h>
+#include <inc/string.h>
+#ifdef JOS_KERNEL
+#include <kern/pmap.h>
+#else
+#include <inc/lib.h>
+#endif
 
-#define sqrt_2 1.41421356237
+#define sqrt_2 1.41421356237309504880
 #define int64_size 64
 
-bool frequency_test(unsigned n, unsigned not_used, uint64_t (*rand_func)()) {
-    unsigned iteration_count = n / int64_size + 1;
-    int S_n = 0;
-    for (unsigned i = 0; i < iteration_count; i++) {
-        uint64_t sequence = rand_func();
-        for (unsigned j = 0; j < int64_size; j++) {
-            unsigned char bit = sequence & 1;
-            if ( bit ) {
-                S_n += 1;
-            } else {
-                S_n -= 1;
+/* The tests work on whole 64-bit words: bit i of a word is the i-th bit
+ * of the sequence, as in the bit-at-a-time loops they replace. */
+
+static bool popcnt_probed = 0, has_popcnt = 0;
+
+static inline unsigned popcount64(uint64_t x) {
+    if (has_popcnt) {
+        uint64_t res;
+        asm("popcnt %1, %0" : "=r"(res) : "rm"(x));
+        return res;
+    }
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (x * 0x0101010101010101ULL) >> 56;
+}
+
+static inline void popcount_init(void) {
+    if (!popcnt_probed) {
+        uint32_t ecx;
+        cpuid(1, NULL, NULL, &ecx, NULL);
+        has_popcnt = (ecx >> 23) & 1;
+        popcnt_probed = 1;
+    }
+}
+
+/* Low {bits} bits set, 0 < bits <= 64 */
+static inline uint64_t low_mask(unsigned bits) {
+    return bits == int64_size ? ~0ULL : (1ULL << bits) - 1;
+}
+
+/* Length of the longest run of ones in {x}: every step shortens all runs by one */
+static inline unsigned longest_run64(uint64_t x) {
+    unsigned len = 0;
+    while (x) {
+        x &= x >> 1;
+        len++;
+    }
+    return len;
+}
+
+const char *const nist_test_names[NIST_NTESTS] = {
+    [NIST_FREQUENCY] = "Frequency test",
+    [NIST_BLOCK_FREQUENCY] = "Frequency block test",
+    [NIST_RUNS] = "Runs test",
+    [NIST_LONGEST_RUN] = "Longest run of ones test",
+    [NIST_MATRIX_RANK] = "Binary matrix rank test",
+    [NIST_DFT] = "Discrete Fourier transform test",
+    [NIST_NON_OVERLAPPING_TEMPLATE] = "Non-overlapping template matching test",
+    [NIST_OVERLAPPING_TEMPLATE] = "Overlapping template matching test",
+    [NIST_UNIVERSAL] = "Maurer's universal statistical test",
+    [NIST_LINEAR_COMPLEXITY] = "Linear complexity test",
+    [NIST_SERIAL] = "Serial test",
+    [NIST_APPROXIMATE_ENTROPY] = "Approximate entropy test",
+    [NIST_CUMULATIVE_SUMS] = "Cumulative sums test",
+    [NIST_RANDOM_EXCURSIONS] = "Random excursions test",
+    [NIST_RANDOM_EXCURSIONS_VARIANT] = "Random excursions variant test",
+};
+
+/* The sequence tests read up to 2 words past the end of the sequence,
+ * the serial tests also wrap a few bits around into them */
+#define seq_words_max (NIST_MAX_BITS / int64_size + 3)
+
+static uint64_t nist_seq_words[seq_words_max];
+
+void nist_stream_init(struct nist_stream *s, unsigned n, unsigned M, unsigned tests) {
+    memset(s, 0, sizeof(*s));
+    s->n = n;
+    s->M = M;
+    s->tests = s->active = tests & NIST_ALL_TESTS;
+    s->block_words = (M + int64_size - 1) / int64_size;
+    s->runs.V_n = 1;
+    s->seq.words = nist_seq_words;
+    //no blocks at all: not applicable
+    if (!M || n / M == 0) {
+        unsigned block_tests = (1U << NIST_BLOCK_FREQUENCY) | (1U << NIST_LONGEST_RUN);
+        s->skipped |= s->tests & block_tests;
+        s->tests &= ~block_tests;
+        s->active &= ~block_tests;
+    }
+    //the sequence does not fit nist_seq_words: not applicable
+    if (!n || n > NIST_MAX_BITS) {
+        s->skipped |= s->tests & NIST_SEQUENCE_TESTS;
+        s->tests &= ~NIST_SEQUENCE_TESTS;
+        s->active &= ~NIST_SEQUENCE_TESTS;
+    }
+    popcount_init();
+}
+
+/* Every block-structured test reads one word it does not use, then the
+ * M bits of the block, the last word only partially */
+static inline unsigned block_word_bits(struct nist_stream *s, unsigned pos) {
+    return pos < s->block_words ? int64_size : s->M - (s->block_words - 1) * int64_size;
+}
+
+static bool feed_frequency(struct nist_stream *s, const uint64_t *words, size_t count) {
+    unsigned need = s->n / int64_size + 1;
+    for (size_t i = 0; i < count && s->freq.words < need; i++, s->freq.words++) {
+        s->freq.ones += popcount64(words[i]);
+    }
+    return s->freq.words == need;
+}
+
+static bool feed_block_frequency(struct nist_stream *s, const uint64_t *words, size_t count) {
+    unsigned N = s->n / s->M;
+    for (size_t i = 0; i < count && s->block.blocks < N; i++) {
+        unsigned pos = s->block.pos++;
+        if (!pos) continue;
+        s->block.ones += popcount64(words[i] & low_mask(block_word_bits(s, pos)));
+        if (pos == s->block_words) {
+            double pi_i = s->block.ones;
+            double term = (pi_i / s->M - 1./2);
+            s->block.ksi_2 += term * term;
+            s->block.ones = 0;
+            s->block.pos = 0;
+            s->block.blocks++;
+        }
+    }
+    return s->block.blocks == N;
+}
+
+static bool feed_runs(struct nist_stream *s, const uint64_t *words, size_t count) {
+    unsigned need = s->n / int64_size + 1;
+    for (size_t i = 0; i < count && s->runs.words < need; i++, s->runs.words++) {
+        uint64_t sequence = words[i];
+        s->runs.ones += popcount64(sequence);
+        //bit j differs from bit j + 1, the top bit has no successor in this word
+        s->runs.V_n += popcount64((sequence ^ (sequence >> 1)) & (~0ULL >> 1));
+        //last bit of the previous word against the first bit of this one
+        if (s->runs.words > 0) {
+            s->runs.V_n += (unsigned)((s->runs.prev >> (int64_size - 1)) ^ (sequence & 1));
+        }
+        s->runs.prev = sequence;
+    }
+    return s->runs.words == need;
+}
+
+/* Class of a block's longest run for the chi-square statistic */
+static inline unsigned longest_run_class(unsigned M, unsigned max_len) {
+    if (M == 8) {
+        if (max_len >= 4) return 3;
+        if (max_len <= 1) return 0;
+        return max_len - 1;
+    } else if (M == 128) {
+        if (max_len >= 9) return 5;
+        if (max_len <= 4) return 0;
+        return max_len - 4;
+    } else { //M = 10000
+        if (max_len >= 16) return 6;
+        if (max_len <= 10) return 0;
+        return max_len - 10;
+    }
+}
+
+static bool feed_longest_run(struct nist_stream *s, const uint64_t *words, size_t count) {
+    unsigned N = s->n / s->M;
+    for (size_t i = 0; i < count && s->longest.blocks < N; i++) {
+        unsigned pos = s->longest.pos++;
+        if (!pos) continue;
+
+        unsigned bits = block_word_bits(s, pos);
+        uint64_t mask = low_mask(bits);
+        uint64_t sequence = words[i] & mask;
+        if (sequence == mask) {
+            s->longest.curr_len += bits;
+        } else {
+            //the run coming from the previous word ends at the lowest zero
+            unsigned low = __builtin_ctzll(~sequence);
+            if (s->longest.curr_len + low > s->longest.max_len) {
+                s->longest.max_len = s->longest.curr_len + low;
+            }
+            //ones at the top go on into the next word
+            unsigned high = __builtin_clzll(~(sequence << (int64_size - bits)));
+            uint64_t inner = sequence & ~low_mask(low + 1) & (mask >> high);
+            unsigned inner_len = longest_run64(inner);
+            if (inner_len > s->longest.max_len) {
+                s->longest.max_len = inner_len;
             }
-            sequence = sequence >> 1;
+            s->longest.curr_len = high;
+        }
+
+        if (pos == s->block_words) {
+            //a run still open at the end of the block is not counted
+            s->longest.v[longest_run_class(s->M, s->longest.max_len)] += 1;
+            s->longest.curr_len = s->longest.max_len = 0;
+            s->longest.pos = 0;
+            s->longest.blocks++;
         }
     }
+    return s->longest.blocks == N;
+}
+
+/* Forward elimination: once the earlier pivots are cleared from a row,
+ * its highest set bit is a new pivot, cleared in turn from the rows below.
+ * The rank is the number of rows left nonzero. */
+static unsigned gf2_rank_one(uint64_t *rows, unsigned size) {
+    unsigned rank = 0;
+    for (unsigned i = 0; i < size; i++) {
+        uint64_t row = rows[i];
+        if (!row) {
+            continue;
+        }
+        unsigned pivot = int64_size - 1 - __builtin_clzll(row);
+        for (unsigned j = i + 1; j < size; j++) {
+            rows[j] ^= row & -((rows[j] >> pivot) & 1);
+        }
+        rank++;
+    }
+    return rank;
+}
+
+void gf2_rank(uint64_t *rows, unsigned size, unsigned count, unsigned *ranks) {
+    for (unsigned i = 0; i < count; i++, rows += size) {
+        ranks[i] = gf2_rank_one(rows, size);
+    }
+}
+
+/* Matrices the sequence holds, each takes size * size consecutive bits */
+static inline unsigned matrix_count(struct nist_stream *s) {
+    return s->n / (NIST_MATRIX_SIZE * NIST_MATRIX_SIZE);
+}
+
+static void rank_batch(struct nist_stream *s) {
+    unsigned count = s->rank.rows / NIST_MATRIX_SIZE, ranks[NIST_RANK_BATCH];
+    gf2_rank(s->rank.row, NIST_MATRIX_SIZE, count, ranks);
+    for (unsigned i = 0; i < count; i++) {
+        switch (ranks[i]) {
+        case NIST_MATRIX_SIZE: s->rank.F_M++; break;
+        case NIST_MATRIX_SIZE - 1: s->rank.F_M_1++; break;
+        default: s->rank.F_other++;
+        }
+    }
+    s->rank.matrices += count;
+    s->rank.rows = 0;
+}
+
+static bool feed_matrix_rank(struct nist_stream *s, const uint64_t *words, size_t count) {
+    unsigned N = matrix_count(s), per_word = int64_size / NIST_MATRIX_SIZE;
+    for (size_t i = 0; i < count && s->rank.matrices < N; i++) {
+        //one or two rows per word, low half first
+        for (unsigned half = 0; half < per_word; half++) {
+            s->rank.row[s->rank.rows++] = (words[i] >> (half * NIST_MATRIX_SIZE)) & low_mask(NIST_MATRIX_SIZE);
+        }
+        if (s->rank.rows == NIST_RANK_BATCH * NIST_MATRIX_SIZE ||
+            s->rank.matrices + s->rank.rows / NIST_MATRIX_SIZE == N) {
+            rank_batch(s);
+        }
+    }
+    return s->rank.matrices == N;
+}
+
+/* The sequence tests share one copy of the first n bits, the bits past
+ * the end are zero */
+static bool feed_sequence(struct nist_stream *s, const uint64_t *words, size_t count) {
+    unsigned need = (s->n + int64_size - 1) / int64_size;
+    for (size_t i = 0; i < count && s->seq.count < need; i++) {
+        s->seq.words[s->seq.count++] = words[i];
+    }
+    if (s->seq.count < need) {
+        return false;
+    }
+    s->seq.words[need - 1] &= low_mask(s->n - (need - 1) * int64_size);
+    for (unsigned i = need; i < need + 3; i++) {
+        s->seq.words[i] = 0;
+    }
+    return true;
+}
+
+/* Sequence tests have no feed of their own */
+static bool (*const nist_feed[NIST_NTESTS])(struct nist_stream *, const uint64_t *, size_t) = {
+    [NIST_FREQUENCY] = feed_frequency,
+    [NIST_BLOCK_FREQUENCY] = feed_block_frequency,
+    [NIST_RUNS] = feed_runs,
+    [NIST_LONGEST_RUN] = feed_longest_run,
+    [NIST_MATRIX_RANK] = feed_matrix_rank,
+};
+
+void nist_stream_feed(struct nist_stream *s, const uint64_t *words, size_t count) {
+    if ((s->active & NIST_SEQUENCE_TESTS) && feed_sequence(s, words, count)) {
+        s->active &= ~NIST_SEQUENCE_TESTS;
+    }
+    for (int test = 0; test < NIST_NTESTS; test++) {
+        if (nist_feed[test] && (s->active & (1U << test)) && nist_feed[test](s, words, count)) {
+            s->active &= ~(1U << test);
+        }
+    }
+}
+
+static bool frequency_result(struct nist_stream *s) {
+    int S_n = 2 * (int)s->freq.ones - (int)(s->freq.words * int64_size);
     //P-value = erfc(S_obs/sqrt(2))
     double abs_res, sqrt_res, S_obs, res;
     abs_func(S_n, &abs_res);
-    sqrt_func(n, &sqrt_res);
+    sqrt_func(s->n, &sqrt_res);
 
     S_obs = abs_res / sqrt_res;
     S_obs /= sqrt_2;
 
     erfc_func(S_obs, &res);
+    s->p_value[NIST_FREQUENCY] = res;
     return res >= 0.01 ? true : false;
 }
 
-bool frequency_block_test(unsigned n, unsigned M, uint64_t (*rand_func)()) {
-    unsigned block_quantity = n / M;
-    double ksi_2 = 0;
-    for (unsigned block_count = 0; block_count < block_quantity; block_count++) {
-        unsigned bit_count = 0;
-        double pi_i = 0;
-        uint64_t sequence = rand_func();
-        while (bit_count < M) {
-            if (bit_count % int64_size == 0) {
-                sequence = rand_func();
-            }
-            unsigned char bit = sequence & 1;
-            sequence = sequence >> 1;
-            if ( bit ) {
-                pi_i += 1;
-            }
-            bit_count += 1;
-        }
-        double term = (pi_i / M - 1./2);
-        ksi_2 += term * term;
-    }
-    ksi_2 *= 4 * M;
+static bool block_frequency_result(struct nist_stream *s) {
+    unsigned block_quantity = s->n / s->M;
+    double ksi_2 = s->block.ksi_2 * (4 * s->M);
     double res;
-    gamma_func(block_quantity / 2., ksi_2 / 2, &res);
+    igamc_func(block_quantity / 2., ksi_2 / 2, &res);
+    s->p_value[NIST_BLOCK_FREQUENCY] = res;
     return res > 0.01 ? true : false;
 }
 
-bool runs_test(unsigned n, unsigned not_used, uint64_t (*rand_func)()) {
-    unsigned iteration_count = n / int64_size + 1;
-    unsigned V_n = 1;
-    double _pi = 0;
-    unsigned char prev_bit;
-    char first_time = 1;
-    for (unsigned i = 0; i < iteration_count; i++) {
-        uint64_t sequence = rand_func();
-        for (unsigned j = 0; j < int64_size; j++) {
-            unsigned char bit = sequence & 1;
-            if ( bit ) {
-                _pi += 1;
-            }
-            if ( !first_time ) {
-                if (bit != prev_bit) {
-                    V_n += 1;
-                }
-            } else { first_time = 0; }
-
-            prev_bit = bit;
-            sequence = sequence >> 1;
-        }
-    }
+static bool runs_result(struct nist_stream *s) {
+    unsigned n = s->n, V_n = s->runs.V_n;
+    double _pi = s->runs.ones;
     _pi /= n;
     double sqrt_res, abs_res;
     abs_func(_pi - 1./2, &abs_res);
@@ -97,13 +342,13 @@ bool runs_test(unsigned n, unsigned not_used, uint64_t (*rand_func)()) {
     res = abs_res / (2 * sqrt_res * pi_one_pi);
 
     erfc_func(res, &ret);
+    s->p_value[NIST_RUNS] = ret;
     return ret >= 0.01 ? true : false;
 }
 
-bool longest_run_of_ones_test(unsigned n, unsigned M, uint64_t (*rand_func)()) {
-    unsigned v[] = {0, 0, 0, 0, 0, 0, 0};
+static bool longest_run_result(struct nist_stream *s) {
     double probabilities[] = {0.2148, 0.3672, 0.2305, 0.1875, 0, 0, 0};
-    unsigned N = n / M, K = 3;
+    unsigned N = s->n / s->M, K = 3, M = s->M;
 
     if (M == 128) {
         K = 5;
@@ -117,121 +362,874 @@ bool longest_run_of_ones_test(unsigned n, unsigned M, uint64_t (*rand_func)()) {
         probabilities[6] = 0.0727;
     }
 
-    for (unsigned block_count = 0; block_count < N; block_count++) {
-        unsigned bit_count = 0, curr_len = 0, max_len = 0;
-        uint64_t sequence = rand_func();
-        while (bit_count < M) {
-            if (bit_count % int64_size == 0) {
-                sequence = rand_func();
-            }
-            unsigned char bit = sequence & 1;
+    double ksi_2 = 0;
+    for (int i = 0; i < K; i++) {
+        double pi_i = probabilities[i];
+        double temp = s->longest.v[i] - N * pi_i;
+        ksi_2 += (temp * temp) / (N * pi_i);
+    }
+    double res;
+    igamc_func(K / 2., ksi_2 / 2, &res);
+    s->p_value[NIST_LONGEST_RUN] = res;
+    return res > 0.01 ? true : false;
+}
 
-            if ( bit ) {
-                curr_len += 1;
-            } else {
-                if (curr_len > max_len) {
-                    max_len = curr_len;
-                }
-                curr_len = 0;
-            }
+/* Probabilities of a random M x M matrix having rank M and M - 1:
+ * prod_(i < M) (1 - 2^(i-M)) and 1/2 prod_(i < M-1) (1 - 2^(i-M))^2 / (1 - 2^(i-M+1)) */
+static void matrix_rank_probabilities(double *p_M, double *p_M_1) {
+    double full = 1, one_less = 0.5;
+    for (int i = 0; i < NIST_MATRIX_SIZE; i++) {
+        double p, q;
+        pow_n_func(2., i - NIST_MATRIX_SIZE, &p);
+        full *= 1 - p;
+        if (i < NIST_MATRIX_SIZE - 1) {
+            pow_n_func(2., i - NIST_MATRIX_SIZE + 1, &q);
+            one_less *= (1 - p) * (1 - p) / (1 - q);
+        }
+    }
+    *p_M = full;
+    *p_M_1 = one_less;
+}
 
-            sequence = sequence >> 1;
-            bit_count += 1;
+static bool matrix_rank_result(struct nist_stream *s) {
+    unsigned N = matrix_count(s), F_M = s->rank.F_M, F_M_1 = s->rank.F_M_1, F_other = s->rank.F_other;
+    if (!N) {
+        s->skipped |= 1U << NIST_MATRIX_RANK;
+        return false;
+    }
+    double p_M, p_M_1, p_other;
+    matrix_rank_probabilities(&p_M, &p_M_1);
+    p_other = 1 - p_M - p_M_1;
+    double temp1 = F_M - p_M * N, temp2 = F_M_1 - p_M_1 * N, temp3 = F_other - p_other * N;
+    double ksi2 = (temp1 * temp1) / (p_M * N) + (temp2 * temp2) / (p_M_1 * N) + (temp3 * temp3) / (p_other * N);
+
+    double res;
+    igamc_func(1., ksi2 / 2, &res);
+    s->p_value[NIST_MATRIX_RANK] = res;
+    return res > 0.01 ? true : false;
+}
+
+/* Sequence tests. They run on s->seq, bit i of the sequence is bit i % 64
+ * of word i / 64, the same order the stream tests read. */
+
+#define nist_alpha NIST_ALPHA
+#define two_pi 6.28318530717958647693
+
+/* Bits pos..pos+63 of the sequence */
+static inline uint64_t seq_bits64(const uint64_t *seq, size_t pos) {
+    size_t word = pos / int64_size;
+    unsigned bit = pos % int64_size;
+    return bit ? (seq[word] >> bit) | (seq[word + 1] << (int64_size - bit)) : seq[word];
+}
+
+/* Replaces what follows the n bits with the first {bits} bits, zero clears it */
+static void seq_set_tail(struct nist_stream *s, unsigned bits) {
+    uint64_t *seq = s->seq.words;
+    size_t word = s->n / int64_size;
+    unsigned bit = s->n % int64_size;
+    seq[word] = bit ? seq[word] & low_mask(bit) : 0;
+    seq[word + 1] = seq[word + 2] = 0;
+    if (!bits) {
+        return;
+    }
+    uint64_t head = seq[0] & low_mask(bits);
+    seq[word] |= head << bit;
+    if (bit && bits > int64_size - bit) {
+        seq[word + 1] = head >> (int64_size - bit);
+    }
+}
+
+/* Rolling-window counter: counts[w]++ for the {windows} m-bit windows
+ * starting at from, from + 1, ...; bit p of the sequence is the lowest bit
+ * of the window starting at p */
+static void count_windows(const uint64_t *seq, size_t from, size_t windows, unsigned m, uint32_t *counts) {
+    uint64_t window = seq_bits64(seq, from) & low_mask(m);
+    size_t next = from + m;
+    uint64_t bits = seq_bits64(seq, next);
+    unsigned left = int64_size;
+    counts[window]++;
+    for (size_t i = 1; i < windows; i++) {
+        window = (window >> 1) | ((bits & 1) << (m - 1));
+        bits >>= 1;
+        if (!--left) {
+            next += int64_size;
+            bits = seq_bits64(seq, next);
+            left = int64_size;
         }
-        if (M == 8) {
-            if (max_len >= 4) {
-                v[3] += 1;
-            } else if (max_len <= 1){
-                v[0] += 1;
-            } else {
-                v[max_len - 1] += 1;
+        counts[window]++;
+    }
+}
+
+//Standard normal distribution function
+static void normal_func(double x, double *res) {
+    double q;
+    erfc_func(-x / sqrt_2, &q);
+    *res = q / 2;
+}
+
+/* A test with several p-values passes when no more of them fail than the
+ * NIST proportion confidence interval allows for {total} sequences */
+bool nist_proportion_pass(unsigned failed, unsigned total) {
+    double sqrt_res;
+    sqrt_func(total * nist_alpha * (1 - nist_alpha), &sqrt_res);
+    return failed <= (unsigned)(total * nist_alpha + 3 * sqrt_res);
+}
+
+void nist_histogram_add(unsigned bins[NIST_HIST_BINS], double p) {
+    unsigned bin = (unsigned)(p * NIST_HIST_BINS);
+    bins[bin < NIST_HIST_BINS ? bin : NIST_HIST_BINS - 1]++;
+}
+
+/* Chi-square of the bin counts against the uniform distribution */
+void nist_uniformity(const unsigned bins[NIST_HIST_BINS], double *res) {
+    unsigned total = 0;
+    for (int i = 0; i < NIST_HIST_BINS; i++) {
+        total += bins[i];
+    }
+    if (!total) {
+        *res = 0;
+        return;
+    }
+    double expected = (double)total / NIST_HIST_BINS, ksi_2 = 0;
+    for (int i = 0; i < NIST_HIST_BINS; i++) {
+        double temp = bins[i] - expected;
+        ksi_2 += temp * temp / expected;
+    }
+    igamc_func((NIST_HIST_BINS - 1) / 2., ksi_2 / 2, res);
+}
+
+static inline unsigned floor_log2(unsigned x) {
+    return int64_size - 1 - __builtin_clzll(x);
+}
+
+/* e^(-2 pi i k / N) for k = 0..N/4 is the product of a coarse and a fine
+ * factor, k = hi * fft_fine + lo: two tables of about sqrt(N/4) entries
+ * instead of one of N/4, for one complex multiply per lookup */
+#define fft_fine_bits 9
+#define fft_fine      (1U << fft_fine_bits)
+#define fft_coarse    (NIST_DFT_MAX_BITS / 4 / fft_fine + 1)
+
+static double nist_fft_fine[2 * fft_fine], nist_fft_coarse[2 * fft_coarse];
+//the twiddles of one FFT stage of up to fft_fine butterflies per block
+static double nist_fft_stage[2 * fft_fine];
+static unsigned nist_fft_twiddle_n = 0;
+
+static void fft_twiddle_init(unsigned N) {
+    if (nist_fft_twiddle_n == N) {
+        return;
+    }
+    for (unsigned k = 0; k < fft_fine; k++) {
+        sincos_func(-two_pi * k / N, &nist_fft_fine[2 * k + 1], &nist_fft_fine[2 * k]);
+    }
+    for (unsigned k = 0; k <= N / 4 / fft_fine; k++) {
+        sincos_func(-two_pi * k * fft_fine / N, &nist_fft_coarse[2 * k + 1], &nist_fft_coarse[2 * k]);
+    }
+    nist_fft_twiddle_n = N;
+}
+
+static inline void fft_twiddle(unsigned k, double *wr, double *wi) {
+    const double *c = nist_fft_coarse + 2 * (k >> fft_fine_bits), *f = nist_fft_fine + 2 * (k & (fft_fine - 1));
+    *wr = c[0] * f[0] - c[1] * f[1];
+    *wi = c[0] * f[1] + c[1] * f[0];
+}
+
+/* e^(-2 pi i k / N), k = 0..N/2: angles past pi/2 are the ones below it
+ * turned by -pi/2 */
+static inline void fft_root(unsigned k, unsigned N, double *wr, double *wi) {
+    if (k <= N / 4) {
+        fft_twiddle(k, wr, wi);
+    } else {
+        fft_twiddle(k - N / 4, wi, wr);
+        *wi = -*wi;
+    }
+}
+
+static inline void fft_butterfly(double *p, unsigned len, double wr, double wi) {
+    double *q = p + len;
+    double tr = wr * q[0] - wi * q[1], ti = wr * q[1] + wi * q[0];
+    q[0] = p[0] - tr;
+    q[1] = p[1] - ti;
+    p[0] += tr;
+    p[1] += ti;
+}
+
+/* In-place complex FFT of {size} points interleaved as re, im, with the
+ * twiddles of fft_twiddle_init(N) for some N >= 2 * size */
+static void fft(double *a, unsigned size, unsigned N) {
+    for (unsigned i = 1, j = 0; i < size; i++) {
+        unsigned bit = size >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            double re = a[2 * i], im = a[2 * i + 1];
+            a[2 * i] = a[2 * j];
+            a[2 * i + 1] = a[2 * j + 1];
+            a[2 * j] = re;
+            a[2 * j + 1] = im;
+        }
+    }
+    for (unsigned len = 2; len <= size; len <<= 1) {
+        unsigned half = len / 2, step = N / len;
+        if (half <= fft_fine) {
+            //many short blocks: the twiddles of the stage once, then the blocks
+            for (unsigned j = 0; j < half; j++) {
+                fft_root(j * step, N, &nist_fft_stage[2 * j], &nist_fft_stage[2 * j + 1]);
             }
-        } else if (M == 128){ //M = 128
-            if (max_len >= 9) {
-                v[5] += 1;
-            } else if (max_len <= 4) {
-                v[0] += 1;
-            } else {
-                v[max_len - 4] += 1;
+            for (unsigned i = 0; i < size; i += len) {
+                for (unsigned j = 0; j < half; j++) {
+                    fft_butterfly(a + 2 * (i + j), len, nist_fft_stage[2 * j], nist_fft_stage[2 * j + 1]);
+                }
             }
-        } else { //M = 10000
-            if (max_len >= 16) {
-                v[6] += 1;
-            } else if (max_len <= 10) {
-                v[0] += 1;
-            } else {
-                v[max_len - 10] += 1;
+        } else {
+            //few long blocks: one twiddle serves the same point of each
+            for (unsigned j = 0; j < half; j++) {
+                double wr, wi;
+                fft_root(j * step, N, &wr, &wi);
+                for (unsigned i = 0; i < size; i += len) {
+                    fft_butterfly(a + 2 * (i + j), len, wr, wi);
+                }
             }
         }
     }
+}
 
-    double ksi_2 = 0;
-    for (int i = 0; i < K; i++) {
-        double pi_i = probabilities[i];
-        double temp = v[i] - N * pi_i;
-        ksi_2 += (temp * temp) / (N * pi_i);
+/* NIST_DFT_MAX_BITS doubles, 4 MB: allocated the first time the test runs
+ * instead of sitting in the BSS of the kernel and of every program that
+ * links nist.o. The kernel takes it from its heap for good, a user
+ * environment maps it lazily at NIST_FFT_ADDR. */
+static double *nist_fft_buf = NULL;
+
+#ifndef JOS_KERNEL
+#define NIST_FFT_ADDR ((void *)0x100000000)
+#endif
+
+static double *fft_buf(void) {
+    if (!nist_fft_buf) {
+        size_t size = NIST_DFT_MAX_BITS * sizeof(double);
+#ifdef JOS_KERNEL
+        nist_fft_buf = kzalloc_region(size);
+#else
+        int res = sys_alloc_region(0, NIST_FFT_ADDR, size, PROT_RW);
+        if (res < 0) {
+            panic("sys_alloc_region: %i", res);
+        }
+        nist_fft_buf = NIST_FFT_ADDR;
+#endif
     }
-    double res;
-    gamma_func(K / 2., ksi_2 / 2, &res);
-    return res > 0.01 ? true : false;
+    return nist_fft_buf;
 }
 
-#define matrix_size 32
-uint32_t matrix[matrix_size];
+static bool dft_result(struct nist_stream *s) {
+    //the N real +-1 values are packed into N/2 complex ones
+    unsigned N = 1U << floor_log2(s->n < NIST_DFT_MAX_BITS ? s->n : NIST_DFT_MAX_BITS), N2 = N / 2;
+    if (N < 4) {
+        s->skipped |= 1U << NIST_DFT;
+        return false;
+    }
+    double *Z = fft_buf();
+    fft_twiddle_init(N);
+    for (unsigned i = 0; i < N; i++) {
+        Z[i] = (s->seq.words[i / int64_size] >> (i % int64_size)) & 1 ? 1. : -1.;
+    }
+    fft(Z, N2, N);
 
-//Check 32x32 matrix's rank
-int matrix_rank(uint64_t (*rand_func)()) {
-    uint64_t sequence = rand_func();;
-    for (int i = 0; i < matrix_size; i++) {
-        if (i % 2 == 0) { //обновляем число каждую вторую итерацию
-            sequence = rand_func();
+    //X_k = E_k + w^k O_k and |X_(N/2 - k)| = |E_k - w^k O_k|, E and O are
+    //the transforms of the even and the odd values
+    double T_2 = 2.995732274 * N; //T^2, T = sqrt(log(1/0.05) N)
+    unsigned N_1 = (Z[0] + Z[1]) * (Z[0] + Z[1]) < T_2;
+    for (unsigned k = 1; k <= N2 / 2; k++) {
+        double *Zk = Z + 2 * k, *Zm = Z + 2 * (N2 - k);
+        double Er = (Zk[0] + Zm[0]) / 2, Ei = (Zk[1] - Zm[1]) / 2;
+        double Or = (Zk[1] + Zm[1]) / 2, Oi = (Zm[0] - Zk[0]) / 2;
+        double wr, wi;
+        fft_twiddle(k, &wr, &wi);
+        double tr = wr * Or - wi * Oi, ti = wr * Oi + wi * Or;
+        N_1 += (Er + tr) * (Er + tr) + (Ei + ti) * (Ei + ti) < T_2;
+        if (k != N2 - k) {
+            N_1 += (Er - tr) * (Er - tr) + (Ei - ti) * (Ei - ti) < T_2;
+        }
+    }
+    double N_0 = 0.95 * N / 2, sqrt_res, abs_res, res;
+    sqrt_func(N / 4. * 0.95 * 0.05, &sqrt_res);
+    abs_func((N_1 - N_0) / sqrt_res, &abs_res);
+    erfc_func(abs_res / sqrt_2, &res);
+    s->p_value[NIST_DFT] = res;
+    return res >= nist_alpha;
+}
+
+#define template_bits    9
+#define template_blocks  8
+#define templates_max    148
+
+static uint16_t nist_templates[templates_max];
+static unsigned nist_template_count = 0;
+
+/* Aperiodic templates: no proper prefix is also a suffix, so occurrences
+ * never overlap and counting every window equals the non-overlapping scan */
+static void templates_init(void) {
+    if (nist_template_count) {
+        return;
+    }
+    for (unsigned t = 0; t < (1U << template_bits); t++) {
+        bool aperiodic = true;
+        for (unsigned shift = 1; shift < template_bits && aperiodic; shift++) {
+            aperiodic = (t & low_mask(template_bits - shift)) != (t >> shift);
+        }
+        if (aperiodic && nist_template_count < templates_max) {
+            nist_templates[nist_template_count++] = t;
         }
-        matrix[i] = (uint32_t)sequence;
-        sequence = sequence >> (int64_size / 2);
     }
-    for (int row = 0; row < matrix_size; row++) {
-        uint32_t seq = matrix[row], mask = 1 << (int64_size / 2 - 1);
-        int first_one = -1;
-        for (int i = 0; i <= int64_size / 2; i++) {
-            if (seq & mask) {
-                first_one = int64_size / 2 - i;
-                break;
+}
+
+static bool non_overlapping_template_result(struct nist_stream *s) {
+    unsigned M = s->n / template_blocks;
+    if (M < template_bits) {
+        s->skipped |= 1U << NIST_NON_OVERLAPPING_TEMPLATE;
+        return false;
+    }
+    templates_init();
+    double mu = (M - template_bits + 1) / (double)(1U << template_bits);
+    double sigma_2 = M * (1. / (1U << template_bits) - (2. * template_bits - 1) / (1U << (2 * template_bits)));
+    double ksi_2[templates_max] = {0};
+    uint32_t counts[1U << template_bits];
+    //one pass per block counts every template at once
+    for (unsigned block = 0; block < template_blocks; block++) {
+        memset(counts, 0, sizeof(counts));
+        count_windows(s->seq.words, (size_t)block * M, M - template_bits + 1, template_bits, counts);
+        for (unsigned i = 0; i < nist_template_count; i++) {
+            double temp = counts[nist_templates[i]] - mu;
+            ksi_2[i] += temp * temp / sigma_2;
+        }
+    }
+    unsigned failed = 0;
+    for (unsigned i = 0; i < nist_template_count; i++) {
+        double res;
+        igamc_func(template_blocks / 2., ksi_2[i] / 2, &res);
+        if (!i) {
+            s->p_value[NIST_NON_OVERLAPPING_TEMPLATE] = res;
+        }
+        failed += res < nist_alpha;
+    }
+    return nist_proportion_pass(failed, nist_template_count);
+}
+
+#define overlapping_M 1032
+
+static bool overlapping_template_result(struct nist_stream *s) {
+    static const double probabilities[] = {0.364091, 0.185659, 0.139381, 0.100571, 0.0704323, 0.139865};
+    unsigned N = s->n / overlapping_M, K = 5, windows = overlapping_M - template_bits + 1;
+    if (!N) {
+        s->skipped |= 1U << NIST_OVERLAPPING_TEMPLATE;
+        return false;
+    }
+    unsigned v[6] = {0};
+    for (unsigned block = 0; block < N; block++) {
+        //bit j of y is set if the 9 bits from j on are all ones
+        size_t from = (size_t)block * overlapping_M;
+        unsigned W = 0;
+        for (unsigned pos = 0; pos < windows; pos += int64_size) {
+            uint64_t y = ~0ULL;
+            for (unsigned k = 0; k < template_bits; k++) {
+                y &= seq_bits64(s->seq.words, from + pos + k);
             }
-            mask = mask >> 1;
+            if (windows - pos < int64_size) {
+                y &= low_mask(windows - pos);
+            }
+            W += popcount64(y);
+        }
+        v[W < K ? W : K]++;
+    }
+    double ksi_2 = 0, res;
+    for (int i = 0; i <= K; i++) {
+        double temp = v[i] - N * probabilities[i];
+        ksi_2 += temp * temp / (N * probabilities[i]);
+    }
+    igamc_func(K / 2., ksi_2 / 2, &res);
+    s->p_value[NIST_OVERLAPPING_TEMPLATE] = res;
+    return res >= nist_alpha;
+}
+
+static bool universal_result(struct nist_stream *s) {
+    static const double expected_value[] = {5.2177052, 6.1962507};
+    static const double variance[] = {2.954, 3.125};
+    unsigned n = s->n, L = n >= 904960 ? 7 : 6;
+    if (n < 387840) {
+        s->skipped |= 1U << NIST_UNIVERSAL;
+        return false;
+    }
+    unsigned Q = 10U << L, K = n / L - Q;
+    uint32_t T[1U << 7] = {0};
+    uint64_t mask = low_mask(L);
+    for (unsigned i = 1; i <= Q; i++) {
+        T[seq_bits64(s->seq.words, (size_t)(i - 1) * L) & mask] = i;
+    }
+    double sum = 0;
+    for (unsigned i = Q + 1; i <= Q + K; i++) {
+        uint64_t block = seq_bits64(s->seq.words, (size_t)(i - 1) * L) & mask;
+        double log_res;
+        log2_func(i - T[block], &log_res);
+        sum += log_res;
+        T[block] = i;
+    }
+    double phi = sum / K, log_K, pow_K, sqrt_res, abs_res, res;
+    log_func(K, &log_K);
+    exp_func(-3. / L * log_K, &pow_K);
+    double c = 0.7 - 0.8 / L + (4 + 32. / L) * pow_K / 15;
+    sqrt_func(variance[L - 6] / K, &sqrt_res);
+    abs_func(phi - expected_value[L - 6], &abs_res);
+    erfc_func(abs_res / (sqrt_2 * c * sqrt_res), &res);
+    s->p_value[NIST_UNIVERSAL] = res;
+    return res >= nist_alpha;
+}
+
+#define linear_complexity_M 500
+#define lc_words (linear_complexity_M / int64_size + 2)
+
+/* Berlekamp-Massey over bit-packed polynomials, bit i of C is c_i.
+ * S holds the bits seen so far reversed, bit i is s_(N - i), so the
+ * discrepancy is the parity of C & S. */
+static unsigned linear_complexity(const uint64_t *seq, size_t from, unsigned M) {
+    uint64_t C[lc_words] = {1}, B[lc_words] = {1}, S[lc_words] = {0}, T[lc_words];
+    unsigned L = 0;
+    int m = -1;
+    uint64_t bits = 0;
+    for (unsigned N = 0; N < M; N++) {
+        if (N % int64_size == 0) {
+            bits = seq_bits64(seq, from + N);
+        }
+        unsigned top = N / int64_size;
+        for (unsigned w = top; w > 0; w--) {
+            S[w] = (S[w] << 1) | (S[w - 1] >> (int64_size - 1));
+        }
+        S[0] = (S[0] << 1) | (bits & 1);
+        bits >>= 1;
+
+        uint64_t d = 0;
+        for (unsigned w = 0; w <= top; w++) {
+            d ^= C[w] & S[w];
+        }
+        if (!(popcount64(d) & 1)) {
+            continue;
         }
-        mask = 1 << (first_one - 1);
-        for (int inner_row = 0; inner_row < matrix_size; inner_row++) {
-            if ((matrix[inner_row] & mask) && inner_row != row) {
-                uint32_t res = matrix[inner_row] ^ matrix[row]; //xor
-                matrix[inner_row] = res;
+        //C += x^(N - m) B
+        unsigned shift = N - m, ws = shift / int64_size, bs = shift % int64_size;
+        memcpy(T, C, sizeof(C));
+        for (int w = lc_words - 1; w >= (int)ws; w--) {
+            uint64_t part = B[w - ws] << bs;
+            if (bs && w > ws) {
+                part |= B[w - ws - 1] >> (int64_size - bs);
             }
+            C[w] ^= part;
         }
+        if (L <= N / 2) {
+            L = N + 1 - L;
+            m = N;
+            memcpy(B, T, sizeof(T));
+        }
+    }
+    return L;
+}
+
+static bool linear_complexity_result(struct nist_stream *s) {
+    static const double probabilities[] = {0.01047, 0.03125, 0.12500, 0.50000, 0.25000, 0.06250, 0.020833};
+    unsigned M = linear_complexity_M, N = s->n / M, K = 6;
+    if (!N) {
+        s->skipped |= 1U << NIST_LINEAR_COMPLEXITY;
+        return false;
     }
-    int rank = 0;
-    for (int row = 0; row < matrix_size; row++) {
-        if (matrix[row]) {
-            rank += 1;
+    double pow_res, sign = M % 2 ? -1 : 1;
+    pow_n_func(0.5, M, &pow_res);
+    double mean = M / 2. + (9. - sign) / 36 - pow_res * (M / 3. + 2. / 9);
+    unsigned v[7] = {0};
+    for (unsigned block = 0; block < N; block++) {
+        double T = sign * (linear_complexity(s->seq.words, (size_t)block * M, M) - mean) + 2. / 9;
+        unsigned i = 0;
+        while (i < K && T > i - 2.5) {
+            i++;
         }
+        v[i]++;
     }
-    return rank;
+    double ksi_2 = 0, res;
+    for (int i = 0; i <= K; i++) {
+        double temp = v[i] - N * probabilities[i];
+        ksi_2 += temp * temp / (N * probabilities[i]);
+    }
+    igamc_func(K / 2., ksi_2 / 2, &res);
+    s->p_value[NIST_LINEAR_COMPLEXITY] = res;
+    return res >= nist_alpha;
 }
 
-///The focus of the test is the rank of disjoint sub-matrices of the entire sequence.
-bool binary_matrix_rank_test(unsigned no_used, unsigned not_used, uint64_t (*rand_func)()) {
-    unsigned N = 38, F_M = 0, F_M_1 = 0, F_other = 0;
-    for (int i = 0; i < N; i++) {
-        int rank = matrix_rank(rand_func);
-        switch (rank) {
-        case 32: F_M++; break;
-        case 31: F_M_1++; break;
-        default: F_other++;
+#define pattern_bits_max 16
+
+static uint32_t nist_pattern_counts[1U << pattern_bits_max];
+
+/* Counts of the n overlapping m-bit patterns of the sequence read as a cycle */
+static void count_patterns(struct nist_stream *s, unsigned m) {
+    memset(nist_pattern_counts, 0, sizeof(uint32_t) << m);
+    seq_set_tail(s, m - 1);
+    count_windows(s->seq.words, 0, s->n, m, nist_pattern_counts);
+    seq_set_tail(s, 0);
+}
+
+/* Turns the m-bit pattern counts into (m-1)-bit ones, a pattern's low
+ * m - 1 bits are the shorter pattern at the same position */
+static void reduce_patterns(unsigned m) {
+    unsigned half = 1U << (m - 1);
+    for (unsigned i = 0; i < half; i++) {
+        nist_pattern_counts[i] += nist_pattern_counts[i + half];
+    }
+}
+
+static void psi_2(unsigned n, unsigned m, double *res) {
+    uint64_t sum = 0;
+    for (unsigned i = 0; i < (1U << m); i++) {
+        sum += (uint64_t)nist_pattern_counts[i] * nist_pattern_counts[i];
+    }
+    *res = (double)sum * (1U << m) / n - n;
+}
+
+static bool serial_result(struct nist_stream *s) {
+    unsigned n = s->n, m = floor_log2(n) - 3;
+    if (n < 32) {
+        s->skipped |= 1U << NIST_SERIAL;
+        return false;
+    }
+    if (m > pattern_bits_max) {
+        m = pattern_bits_max;
+    }
+    double psi_m, psi_m_1, psi_m_2;
+    count_patterns(s, m);
+    psi_2(n, m, &psi_m);
+    reduce_patterns(m);
+    psi_2(n, m - 1, &psi_m_1);
+    reduce_patterns(m - 1);
+    psi_2(n, m - 2, &psi_m_2);
+
+    double a_1, a_2, p_1, p_2;
+    pow_n_func(2., (int)m - 2, &a_1);
+    pow_n_func(2., (int)m - 3, &a_2);
+    igamc_func(a_1, (psi_m - psi_m_1) / 2, &p_1);
+    igamc_func(a_2, (psi_m - 2 * psi_m_1 + psi_m_2) / 2, &p_2);
+    s->p_value[NIST_SERIAL] = p_1;
+    return nist_proportion_pass((p_1 < nist_alpha) + (p_2 < nist_alpha), 2);
+}
+
+static void phi_entropy(unsigned n, unsigned m, double *res) {
+    double sum = 0;
+    for (unsigned i = 0; i < (1U << m); i++) {
+        if (nist_pattern_counts[i]) {
+            double pi_i = (double)nist_pattern_counts[i] / n, log_res;
+            log_func(pi_i, &log_res);
+            sum += pi_i * log_res;
         }
     }
-    double temp1 = F_M - 0.2888 * N, temp2 = F_M_1 - 0.5776 * N, temp3 = F_other - 0.1336 * N;
-    double ksi2 = (temp1 * temp1) / (0.2888 * N) + (temp2 * temp2) / (0.5776 * N) + (temp3 * temp3) / (0.1336 * N);
+    *res = sum;
+}
 
-    double res;
-    gamma_func(1., ksi2 / 2, &res);
-    return res > 0.01 ? true : false;
+static bool approximate_entropy_result(struct nist_stream *s) {
+    unsigned n = s->n, m = floor_log2(n) - 6;
+    if (n < 128) {
+        s->skipped |= 1U << NIST_APPROXIMATE_ENTROPY;
+        return false;
+    }
+    if (m >= pattern_bits_max) {
+        m = pattern_bits_max - 1;
+    }
+    double phi_m, phi_m_1;
+    count_patterns(s, m + 1);
+    phi_entropy(n, m + 1, &phi_m_1);
+    reduce_patterns(m + 1);
+    phi_entropy(n, m, &phi_m);
+
+    double ap_en = phi_m - phi_m_1, a, res;
+    double ksi_2 = 2. * n * (0.69314718055994530942 - ap_en);
+    pow_n_func(2., (int)m - 1, &a);
+    igamc_func(a, ksi_2 / 2, &res);
+    s->p_value[NIST_APPROXIMATE_ENTROPY] = res;
+    return res >= nist_alpha;
+}
+
+/* Walk step, highest and lowest partial sum of every byte */
+static int8_t cusum_step[256], cusum_high[256], cusum_low[256];
+static bool cusum_ready = 0;
+
+static void cusum_init(void) {
+    if (cusum_ready) {
+        return;
+    }
+    for (unsigned byte = 0; byte < 256; byte++) {
+        int sum = 0, high = 0, low = 0;
+        for (unsigned i = 0; i < 8; i++) {
+            sum += (byte >> i) & 1 ? 1 : -1;
+            high = sum > high ? sum : high;
+            low = sum < low ? sum : low;
+        }
+        cusum_step[byte] = sum;
+        cusum_high[byte] = high;
+        cusum_low[byte] = low;
+    }
+    cusum_ready = 1;
+}
+
+static void cumulative_sums_p(unsigned n, int z, double *res) {
+    double sqrt_n, sum_1 = 0, sum_2 = 0, a, b;
+    int n_z = (int)n / z;
+    sqrt_func(n, &sqrt_n);
+    for (int k = (-n_z + 1) / 4; k <= (n_z - 1) / 4; k++) {
+        normal_func((4 * k + 1) * z / sqrt_n, &a);
+        normal_func((4 * k - 1) * z / sqrt_n, &b);
+        sum_1 += a - b;
+    }
+    for (int k = (-n_z - 3) / 4; k <= (n_z - 1) / 4; k++) {
+        normal_func((4 * k + 3) * z / sqrt_n, &a);
+        normal_func((4 * k + 1) * z / sqrt_n, &b);
+        sum_2 += a - b;
+    }
+    *res = 1 - sum_1 + sum_2;
+}
+
+static bool cumulative_sums_result(struct nist_stream *s) {
+    const uint8_t *bytes = (const uint8_t *)s->seq.words;
+    unsigned n = s->n;
+    int S = 0, sup = 0, inf = 0;
+    cusum_init();
+    //whole bytes through the tables, the tail bit by bit
+    for (unsigned i = 0; i < n / 8; i++) {
+        sup = S + cusum_high[bytes[i]] > sup ? S + cusum_high[bytes[i]] : sup;
+        inf = S + cusum_low[bytes[i]] < inf ? S + cusum_low[bytes[i]] : inf;
+        S += cusum_step[bytes[i]];
+    }
+    for (unsigned i = n / 8 * 8; i < n; i++) {
+        S += (s->seq.words[i / int64_size] >> (i % int64_size)) & 1 ? 1 : -1;
+        sup = S > sup ? S : sup;
+        inf = S < inf ? S : inf;
+    }
+    //backward sums are S_n - S_k, their extremes come from the same sup and inf
+    int forward = sup > -inf ? sup : -inf;
+    int backward = sup - S > S - inf ? sup - S : S - inf;
+    double p_forward, p_backward;
+    cumulative_sums_p(n, forward, &p_forward);
+    cumulative_sums_p(n, backward, &p_backward);
+    s->p_value[NIST_CUMULATIVE_SUMS] = p_forward;
+    return nist_proportion_pass((p_forward < nist_alpha) + (p_backward < nist_alpha), 2);
+}
+
+#define excursion_states 4
+#define variant_states   9
+#define excursions_min_J 500
+
+struct excursions {
+    unsigned J;
+    unsigned v[2 * excursion_states + 1][6];      //cycles with k visits to a state, 5 or more in the last
+    unsigned visits[2 * variant_states + 1];      //total visits to a state
+};
+
+static void close_cycle(struct excursions *e, unsigned *cycle) {
+    for (int x = 0; x < 2 * excursion_states + 1; x++) {
+        e->v[x][cycle[x] < 5 ? cycle[x] : 5]++;
+        cycle[x] = 0;
+    }
+    e->J++;
+}
+
+/* Cycles of the walk are the parts between its zeros, with one zero added
+ * before the first step and one after the last */
+static void random_walk(struct nist_stream *s, struct excursions *e) {
+    unsigned cycle[2 * excursion_states + 1] = {0};
+    int S = 0;
+    memset(e, 0, sizeof(*e));
+    for (unsigned i = 0; i < s->n; i++) {
+        S += (s->seq.words[i / int64_size] >> (i % int64_size)) & 1 ? 1 : -1;
+        if (S >= -variant_states && S <= variant_states) {
+            e->visits[S + variant_states]++;
+        }
+        if (S >= -excursion_states && S <= excursion_states) {
+            cycle[S + excursion_states]++;
+        }
+        if (!S) {
+            close_cycle(e, cycle);
+        }
+    }
+    if (S) {
+        close_cycle(e, cycle);
+    }
+}
+
+static bool random_excursions_result(struct nist_stream *s) {
+    struct excursions e;
+    random_walk(s, &e);
+    if (e.J < excursions_min_J) {
+        s->skipped |= 1U << NIST_RANDOM_EXCURSIONS;
+        return false;
+    }
+    unsigned failed = 0;
+    for (int x = -excursion_states; x <= excursion_states; x++) {
+        if (!x) continue;
+        //probability of k visits to x in a cycle
+        double a = 1. / (2 * (x < 0 ? -x : x)), pi[6], pow_res, ksi_2 = 0, res;
+        pi[0] = 1 - a;
+        for (int k = 1; k < 5; k++) {
+            pow_n_func(1 - a, k - 1, &pow_res);
+            pi[k] = a * a * pow_res;
+        }
+        pow_n_func(1 - a, 4, &pow_res);
+        pi[5] = a * pow_res;
+        for (int k = 0; k < 6; k++) {
+            double temp = e.v[x + excursion_states][k] - e.J * pi[k];
+            ksi_2 += temp * temp / (e.J * pi[k]);
+        }
+        igamc_func(5. / 2, ksi_2 / 2, &res);
+        if (x == -excursion_states) {
+            s->p_value[NIST_RANDOM_EXCURSIONS] = res;
+        }
+        failed += res < nist_alpha;
+    }
+    return nist_proportion_pass(failed, 2 * excursion_states);
+}
+
+static bool random_excursions_variant_result(struct nist_stream *s) {
+    struct excursions e;
+    random_walk(s, &e);
+    if (e.J < excursions_min_J) {
+        s->skipped |= 1U << NIST_RANDOM_EXCURSIONS_VARIANT;
+        return false;
+    }
+    unsigned failed = 0;
+    for (int x = -variant_states; x <= variant_states; x++) {
+        if (!x) continue;
+        double sqrt_res, abs_res, res;
+        sqrt_func(2. * e.J * (4 * (x < 0 ? -x : x) - 2), &sqrt_res);
+        abs_func((double)e.visits[x + variant_states] - e.J, &abs_res);
+        erfc_func(abs_res / sqrt_res, &res);
+        if (x == -variant_states) {
+            s->p_value[NIST_RANDOM_EXCURSIONS_VARIANT] = res;
+        }
+        failed += res < nist_alpha;
+    }
+    return nist_proportion_pass(failed, 2 * variant_states);
+}
+
+static bool (*const nist_result[NIST_NTESTS])(struct nist_stream *) = {
+    [NIST_FREQUENCY] = frequency_result,
+    [NIST_BLOCK_FREQUENCY] = block_frequency_result,
+    [NIST_RUNS] = runs_result,
+    [NIST_LONGEST_RUN] = longest_run_result,
+    [NIST_MATRIX_RANK] = matrix_rank_result,
+    [NIST_DFT] = dft_result,
+    [NIST_NON_OVERLAPPING_TEMPLATE] = non_overlapping_template_result,
+    [NIST_OVERLAPPING_TEMPLATE] = overlapping_template_result,
+    [NIST_UNIVERSAL] = universal_result,
+    [NIST_LINEAR_COMPLEXITY] = linear_complexity_result,
+    [NIST_SERIAL] = serial_result,
+    [NIST_APPROXIMATE_ENTROPY] = approximate_entropy_result,
+    [NIST_CUMULATIVE_SUMS] = cumulative_sums_result,
+    [NIST_RANDOM_EXCURSIONS] = random_excursions_result,
+    [NIST_RANDOM_EXCURSIONS_VARIANT] = random_excursions_variant_result,
+};
+
+unsigned nist_stream_result(struct nist_stream *s) {
+    unsigned passed = 0;
+    for (int test = 0; test < NIST_NTESTS; test++) {
+        unsigned bit = 1U << test;
+        if ((s->tests & bit) && !(s->active & bit) && nist_result[test](s)) {
+            passed |= bit;
+        }
+    }
+    return passed;
+}
+
+/* Words generated per fill call */
+#define nist_chunk_words 256
+
+unsigned nist_stream_run(unsigned n, unsigned M, unsigned tests, void (*fill)(void *, size_t), unsigned *skipped,
+                         double *p_values) {
+    struct nist_stream s;
+    uint64_t chunk[nist_chunk_words];
+    nist_stream_init(&s, n, M, tests);
+    while (s.active) {
+        fill(chunk, sizeof(chunk));
+        nist_stream_feed(&s, chunk, nist_chunk_words);
+    }
+    unsigned passed = nist_stream_result(&s);
+    if (skipped) {
+        *skipped = s.skipped;
+    }
+    if (p_values) {
+        memcpy(p_values, s.p_value, sizeof(s.p_value));
+    }
+    return passed;
+}
+
+/* Stand-alone tests pull one word at a time from {rand_func} */
+static bool nist_run_single(enum nist_test test, unsigned n, unsigned M, uint64_t (*rand_func)()) {
+    struct nist_stream s;
+    nist_stream_init(&s, n, M, 1U << test);
+    while (s.active) {
+        uint64_t word = rand_func();
+        nist_stream_feed(&s, &word, 1);
+    }
+    return nist_stream_result(&s) ? true : false;
+}
+
+bool frequency_test(unsigned n, unsigned not_used, uint64_t (*rand_func)()) {
+    return nist_run_single(NIST_FREQUENCY, n, not_used, rand_func);
+}
+
+bool frequency_block_test(unsigned n, unsigned M, uint64_t (*rand_func)()) {
+    return nist_run_single(NIST_BLOCK_FREQUENCY, n, M, rand_func);
+}
+
+bool runs_test(unsigned n, unsigned not_used, uint64_t (*rand_func)()) {
+    return nist_run_single(NIST_RUNS, n, not_used, rand_func);
+}
+
+bool longest_run_of_ones_test(unsigned n, unsigned M, uint64_t (*rand_func)()) {
+    return nist_run_single(NIST_LONGEST_RUN, n, M, rand_func);
+}
+
+///The focus of the test is the rank of disjoint sub-matrices of the entire sequence.
+bool binary_matrix_rank_test(unsigned no_used, unsigned not_used, uint64_t (*rand_func)()) {
+    return nist_run_single(NIST_MATRIX_RANK, no_used, not_used, rand_func);
+}
+
+bool discrete_fourier_transform_test(unsigned n, unsigned not_used, uint64_t (*rand_func)()) {
+    return nist_run_single(NIST_DFT, n, not_used, rand_func);
+}
+
+bool non_overlapping_template_test(unsigned n, unsigned not_used, uint64_t (*rand_func)()) {
+    return nist_run_single(NIST_NON_OVERLAPPING_TEMPLATE, n, not_used, rand_func);
+}
+
+bool overlapping_template_test(unsigned n, unsigned not_used, uint64_t (*rand_func)()) {
+    return nist_run_single(NIST_OVERLAPPING_TEMPLATE, n, not_used, rand_func);
+}
+
+bool universal_test(unsigned n, unsigned not_used, uint64_t (*rand_func)()) {
+    return nist_run_single(NIST_UNIVERSAL, n, not_used, rand_func);
+}
+
+bool linear_complexity_test(unsigned n, unsigned not_used, uint64_t (*rand_func)()) {
+    return nist_run_single(NIST_LINEAR_COMPLEXITY, n, not_used, rand_func);
+}
+
+bool serial_test(unsigned n, unsigned not_used, uint64_t (*rand_func)()) {
+    return nist_run_single(NIST_SERIAL, n, not_used, rand_func);
+}
+
+bool approximate_entropy_test(unsigned n, unsigned not_used, uint64_t (*rand_func)()) {
+    return nist_run_single(NIST_APPROXIMATE_ENTROPY, n, not_used, rand_func);
+}
+
+bool cumulative_sums_test(unsigned n, unsigned not_used, uint64_t (*rand_func)()) {
+    return nist_run_single(NIST_CUMULATIVE_SUMS, n, not_used, rand_func);
+}
+
+bool random_excursions_test(unsigned n, unsigned not_used, uint64_t (*rand_func)()) {
+    return nist_run_single(NIST_RANDOM_EXCURSIONS, n, not_used, rand_func);
+}
+
+bool random_excursions_variant_test(unsigned n, unsigned not_used, uint64_t (*rand_func)()) {
+    return nist_run_single(NIST_RANDOM_EXCURSIONS_VARIANT, n, not_used, rand_func);
 }
-#undef matrix_size
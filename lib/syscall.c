@@ -129,6 +129,11 @@ sys_ipc_try_send(envid_t envid, uintptr_t value, void *srcva, size_t size, int p
     return syscall(SYS_ipc_try_send, 0, envid, value, (uintptr_t)srcva, size, perm, 0);
 }
 
+int
+sys_getrandom(void *buf, size_t len) {
+    return syscall(SYS_getrandom, 0, (uintptr_t)buf, len, 0, 0, 0, 0);
+}
+
 int
 sys_ipc_recv(void *dstva, size_t size) {
     int res = syscall(SYS_ipc_recv, 1, (uintptr_t)dstva, size, 0, 0, 0, 0);
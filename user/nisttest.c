@@ -0,0 +1,210 @@
+/* Parallel NIST SP 800-22 test driver.
+ *
+ * The parent forks NWORKERS workers and hands out batches of BATCH
+ * sequences as IPC pages, each batch with the seed its sequences are
+ * generated from. A worker runs every test over its batch and sends back
+ * the p-values and the mask of tests that were not applicable, the parent
+ * hands the next batch to whichever worker answered. The sequence tests
+ * keep their work space in static buffers, after fork every worker has its
+ * own copy.
+ *
+ * Pass proportions and uniformity are both taken over one p-value per test
+ * and sequence, the first one for tests that produce several.
+ *
+ * The generator under test is argv[1] if the program gets arguments,
+ * NIST_BACKEND otherwise: "seeded" or one of the crng backends, as in the
+ * crng_test monitor command. With "seeded", sequence k is ChaCha20 keyed
+ * from SEED and k alone, so the results do not depend on how batches land
+ * on workers. A crng backend seeds itself on first use, after the fork,
+ * so every worker draws from its own instance. */
+
+#include <inc/lib.h>
+#include <inc/x86.h>
+#include <inc/nist.h>
+
+#define NSEQUENCES 200
+#define NWORKERS   4
+#define BATCH      8 /* sequences per batch, the reply must fit a page */
+#define SEQ_N      750000
+#define SEQ_M      10000
+#define SEED       0x5eed0f5e9e3779b9ULL
+
+#ifndef NIST_BACKEND
+#define NIST_BACKEND "seeded"
+#endif
+
+#define JOB_ADDR   ((void *)0xa00000)
+#define REPLY_ADDR ((void *)0xb00000)
+
+struct job {
+    uint64_t seed;
+    unsigned first, count;
+};
+
+struct reply {
+    unsigned first, count;
+    unsigned skipped[BATCH];
+    double p_value[BATCH][NIST_NTESTS];
+};
+
+static_assert(sizeof(struct reply) <= PAGE_SIZE, "NIST reply does not fit a page");
+
+/* Worker side */
+
+/* NULL for the seeded ChaCha20 streams */
+static const struct crng_backend *backend;
+
+static uint64_t seed_state;
+static struct chacha_stream stream;
+
+/* splitmix64 over seed_state */
+static uint64_t
+seed_next(void) {
+    uint64_t z = (seed_state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static void
+stream_fill(void *buf, size_t len) {
+    chacha_stream_fill(&stream, buf, len);
+}
+
+static void
+worker(envid_t parent) {
+    envid_t from;
+    struct job job;
+
+    for (;;) {
+        size_t size = PAGE_SIZE;
+        int32_t res = ipc_recv(&from, JOB_ADDR, &size, NULL);
+        if (from != parent) continue;
+        if (res <= 0) return;
+        memcpy(&job, JOB_ADDR, sizeof(job));
+
+        /* A fresh page, the parent may still hold the previous one */
+        if ((res = sys_alloc_region(0, REPLY_ADDR, PAGE_SIZE, PROT_RW)) < 0)
+            panic("sys_alloc_region: %i", res);
+        struct reply *reply = REPLY_ADDR;
+        reply->first = job.first;
+        reply->count = job.count;
+        for (unsigned i = 0; i < job.count; i++) {
+            void (*fill)(void *, size_t) = stream_fill;
+            if (backend) {
+                fill = backend->fill;
+            } else {
+                seed_state = job.seed ^ (job.first + i);
+                chacha_stream_init(&stream, seed_next, NULL);
+                stream.reseed_interval = 0;
+            }
+            nist_stream_run(SEQ_N, SEQ_M, NIST_ALL_TESTS, fill, &reply->skipped[i], reply->p_value[i]);
+        }
+        ipc_send(parent, job.count, REPLY_ADDR, PAGE_SIZE, PROT_RW);
+    }
+}
+
+/* Parent side */
+
+static unsigned passed[NIST_NTESTS], applicable[NIST_NTESTS];
+static unsigned histogram[NIST_NTESTS][NIST_HIST_BINS];
+
+/* Sends the next batch to {to}, returns false if there is none left */
+static bool
+send_job(envid_t to, unsigned *next) {
+    if (*next >= NSEQUENCES) return 0;
+
+    int res = sys_alloc_region(0, JOB_ADDR, PAGE_SIZE, PROT_RW);
+    if (res < 0) panic("sys_alloc_region: %i", res);
+    struct job *job = JOB_ADDR;
+    job->seed = SEED;
+    job->first = *next;
+    job->count = MIN(BATCH, NSEQUENCES - *next);
+    *next += job->count;
+    ipc_send(to, 1, JOB_ADDR, PAGE_SIZE, PROT_RW);
+    return 1;
+}
+
+static void
+merge(const struct reply *reply) {
+    for (unsigned i = 0; i < reply->count; i++) {
+        for (int test = 0; test < NIST_NTESTS; test++) {
+            if ((reply->skipped[i] >> test) & 1) continue;
+            applicable[test]++;
+            passed[test] += reply->p_value[i][test] >= NIST_ALPHA;
+            nist_histogram_add(histogram[test], reply->p_value[i][test]);
+        }
+    }
+}
+
+/* Prints {p} with four decimals, cprintf has no floating point */
+static void
+print_p(double p) {
+    unsigned fixed = (unsigned)(p * 10000 + 0.5);
+    cprintf("%u.%04u", fixed / 10000, fixed % 10000);
+}
+
+static void
+report(uint64_t cycles) {
+    unsigned failed_tests = 0;
+
+    cprintf("%-40s %9s %5s  %-29s %s\n", "test", "passed", "prop", "p-value histogram", "uniformity");
+    for (int test = 0; test < NIST_NTESTS; test++) {
+        unsigned total = applicable[test];
+        bool prop_ok = total && nist_proportion_pass(total - passed[test], total);
+        double uniformity;
+        nist_uniformity(histogram[test], &uniformity);
+        bool uni_ok = uniformity >= NIST_UNIFORMITY_ALPHA;
+
+        cprintf("%-40s %4u/%-4u %5s ", nist_test_names[test], passed[test], total, prop_ok ? "ok" : "FAIL");
+        for (int bin = 0; bin < NIST_HIST_BINS; bin++)
+            cprintf("%3u", histogram[test][bin]);
+        cprintf(" ");
+        print_p(uniformity);
+        cprintf(" %s\n", uni_ok ? "ok" : "FAIL");
+        failed_tests += !prop_ok || !uni_ok;
+    }
+    cprintf("%u sequences on %u workers, %lu Mcycles per sequence: %u of %u tests failed\n",
+            NSEQUENCES, NWORKERS, (unsigned long)(cycles / NSEQUENCES / 1000000), failed_tests, NIST_NTESTS);
+}
+
+void
+umain(int argc, char **argv) {
+    envid_t parent = sys_getenvid(), workers[NWORKERS], from;
+    unsigned next = 0, busy = 0;
+    const char *name = argc > 1 ? argv[1] : NIST_BACKEND;
+
+    if (strcmp(name, "seeded") && !(backend = crng_backend_find(name))) {
+        cprintf("Unknown function %s, terminate testing\n", name);
+        return;
+    }
+    cprintf("Testing CPRNG %s (n size: %u, M size: %u)\n", name, SEQ_N, SEQ_M);
+    uint64_t start = read_tsc();
+
+    for (int i = 0; i < NWORKERS; i++) {
+        if ((workers[i] = fork()) < 0)
+            panic("fork: %i", workers[i]);
+        if (!workers[i]) {
+            worker(parent);
+            return;
+        }
+    }
+
+    for (int i = 0; i < NWORKERS; i++)
+        busy += send_job(workers[i], &next);
+
+    /* Whoever answers gets the next batch */
+    while (busy) {
+        size_t size = PAGE_SIZE;
+        int32_t res = ipc_recv(&from, REPLY_ADDR, &size, NULL);
+        if (res < 0) panic("ipc_recv: %i", res);
+        merge(REPLY_ADDR);
+        busy--;
+        busy += send_job(from, &next);
+    }
+
+    for (int i = 0; i < NWORKERS; i++)
+        ipc_send(workers[i], 0, NULL, 0, 0);
+
+    report(read_tsc() - start);
+}